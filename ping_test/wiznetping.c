@@ -14,23 +14,9 @@
 #include <string.h>
 #include <stdio.h>
 #include <util/delay.h>
+#include "w5100.h"
 
 #define BAUD_RATE 19200
-// AVRJazz Mega168/328 SPI I/O
-#define SPI_PORT PORTB
-#define SPI_DDR  DDRB
-#define SPI_CS   PORTB2
-// Wiznet W5100 Op Code
-#define WIZNET_WRITE_OPCODE 0xF0
-#define WIZNET_READ_OPCODE 0x0F
-// Wiznet W5100 Register Addresses
-#define MR   0x0000   // Mode Register
-#define GAR  0x0001   // Gateway Address: 0x0001 to 0x0004
-#define SUBR 0x0005   // Subnet mask Address: 0x0005 to 0x0008
-#define SAR  0x0009   // Source Hardware Address (MAC): 0x0009 to 0x000E
-#define SIPR 0x000F   // Source IP Address: 0x000F to 0x0012
-#define RMSR 0x001A   // RX Memory Size Register
-#define TMSR 0x001B   // TX Memory Size Register
 void uart_init(void)
 {
   UBRR0H = (((F_CPU/BAUD_RATE)/16)-1)>>8;	// set baud rate
@@ -80,114 +66,40 @@ void ansi_me(void)
   putchar('0');
   putchar('m');
 }
-void SPI_Write(unsigned int addr,unsigned char data)
-{
-  // Activate the CS pin
-  SPI_PORT &= ~(1<<SPI_CS);
-  // Start Wiznet W5100 Write OpCode transmission
-  SPDR = WIZNET_WRITE_OPCODE;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));
-  // Start Wiznet W5100 Address High Bytes transmission
-  SPDR = (addr & 0xFF00) >> 8;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));
-  // Start Wiznet W5100 Address Low Bytes transmission
-  SPDR = addr & 0x00FF;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));   
-
-  // Start Data transmission
-  SPDR = data;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));
-  // CS pin is not active
-  SPI_PORT |= (1<<SPI_CS);
-}
-unsigned char SPI_Read(unsigned int addr)
-{
-  // Activate the CS pin
-  SPI_PORT &= ~(1<<SPI_CS);
-  // Start Wiznet W5100 Read OpCode transmission
-  SPDR = WIZNET_READ_OPCODE;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));
-  // Start Wiznet W5100 Address High Bytes transmission
-  SPDR = (addr & 0xFF00) >> 8;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));
-  // Start Wiznet W5100 Address Low Bytes transmission
-  SPDR = addr & 0x00FF;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));   
-
-  // Send Dummy transmission for reading the data
-  SPDR = 0x00;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));  
-
-  // CS pin is not active
-  SPI_PORT |= (1<<SPI_CS);
-  return(SPDR);
-}
 void W5100_Init(void)
 {
   // Ethernet Setup
-  unsigned char mac_addr[] = {0x00,0x16,0x36,0xDE,0x58,0xF6};
-  unsigned char ip_addr[] = {192,168,2,10};
-  unsigned char sub_mask[] = {255,255,255,0};
-  unsigned char gtw_addr[] = {192,168,2,1};
-  // Setting the Wiznet W5100 Mode Register: 0x0000
-  SPI_Write(MR,0x80);            // MR = 0b10000000;
-  _delay_ms(1);
-  printf("Reading MR: %d\n\n",SPI_Read(MR));
-  // Setting the Wiznet W5100 Gateway Address (GAR): 0x0001 to 0x0004
-  printf("Setting Gateway Address %d.%d.%d.%d\n",gtw_addr[0],gtw_addr[1],\
-          gtw_addr[2],gtw_addr[3]);
-  SPI_Write(GAR + 0,gtw_addr[0]);
-  SPI_Write(GAR + 1,gtw_addr[1]);
-  SPI_Write(GAR + 2,gtw_addr[2]);
-  SPI_Write(GAR + 3,gtw_addr[3]);
-  _delay_ms(1);
-  printf("Reading GAR: %d.%d.%d.%d\n\n",SPI_Read(GAR + 0),SPI_Read(GAR + 1),\
-          SPI_Read(GAR + 2),SPI_Read(GAR + 3));
-  // Setting the Wiznet W5100 Source Address Register (SAR): 0x0009 to 0x000E
-  printf("Setting Source Address %.2x:%.2x:%.2x:%.2x:%.2x:%.2x\n",mac_addr[0],mac_addr[1],\
-          mac_addr[2],mac_addr[3],mac_addr[4],mac_addr[5]);
-  SPI_Write(SAR + 0,mac_addr[0]);
-  SPI_Write(SAR + 1,mac_addr[1]);
-  SPI_Write(SAR + 2,mac_addr[2]);
-  SPI_Write(SAR + 3,mac_addr[3]);
-  SPI_Write(SAR + 4,mac_addr[4]);
-  SPI_Write(SAR + 5,mac_addr[5]);
-  _delay_ms(1);
-  printf("Reading SAR: %.2x:%.2x:%.2x:%.2x:%.2x:%.2x\n\n",SPI_Read(SAR + 0),SPI_Read(SAR + 1),\
-          SPI_Read(SAR + 2),SPI_Read(SAR + 3),SPI_Read(SAR + 4),SPI_Read(SAR + 5));
-  // Setting the Wiznet W5100 Sub Mask Address (SUBR): 0x0005 to 0x0008
-  printf("Setting Sub Mask Address %d.%d.%d.%d\n",sub_mask[0],sub_mask[1],\
-          sub_mask[2],sub_mask[3]);
-  SPI_Write(SUBR + 0,sub_mask[0]);
-  SPI_Write(SUBR + 1,sub_mask[1]);
-  SPI_Write(SUBR + 2,sub_mask[2]);
-  SPI_Write(SUBR + 3,sub_mask[3]);
-  _delay_ms(1);
-  printf("Reading SUBR: %d.%d.%d.%d\n\n",SPI_Read(SUBR + 0),SPI_Read(SUBR + 1),\
-          SPI_Read(SUBR + 2),SPI_Read(SUBR + 3));
-  // Setting the Wiznet W5100 IP Address (SIPR): 0x000F to 0x0012
-  printf("Setting IP Address %d.%d.%d.%d\n",ip_addr[0],ip_addr[1],\
-          ip_addr[2],ip_addr[3]);
-  SPI_Write(SIPR + 0,ip_addr[0]);
-  SPI_Write(SIPR + 1,ip_addr[1]);
-  SPI_Write(SIPR + 2,ip_addr[2]);
-  SPI_Write(SIPR + 3,ip_addr[3]);
-  _delay_ms(1);
-  printf("Reading SIPR: %d.%d.%d.%d\n\n",SPI_Read(SIPR + 0),SPI_Read(SIPR + 1),\
-          SPI_Read(SIPR + 2),SPI_Read(SIPR + 3));
+  const w5100_net_t net = {
+    {192,168,2,1},                   // Gateway
+    {255,255,255,0},                 // Subnet mask
+    {0x00,0x16,0x36,0xDE,0x58,0xF6}, // MAC
+    {192,168,2,10},                  // IP
+  };
+  w5100_net_t rd;
+
+  printf("Setting Gateway Address %d.%d.%d.%d\n",net.gateway[0],net.gateway[1],\
+          net.gateway[2],net.gateway[3]);
+  printf("Setting Source Address %.2x:%.2x:%.2x:%.2x:%.2x:%.2x\n",net.mac[0],net.mac[1],\
+          net.mac[2],net.mac[3],net.mac[4],net.mac[5]);
+  printf("Setting Sub Mask Address %d.%d.%d.%d\n",net.subnet[0],net.subnet[1],\
+          net.subnet[2],net.subnet[3]);
+  printf("Setting IP Address %d.%d.%d.%d\n",net.ip[0],net.ip[1],\
+          net.ip[2],net.ip[3]);
+  // Reset, program GAR..SIPR, RMSR and TMSR, then read them all back
+  if (!w5100_init(&net))
+    printf("Read back does not match!\n");
 
-  // Setting the Wiznet W5100 RX and TX Memory Size, we use 2KB for Rx/Tx 4 channels
-  printf("Setting Wiznet RMSR and TMSR\n\n");
-  SPI_Write(RMSR,0x55);
-  SPI_Write(TMSR,0x55);
+  printf("Reading MR: %d\n\n",w5100_read8(MR));
+  w5100_read_block(GAR,(uint8_t *)&rd,sizeof(rd));
+  printf("Reading GAR: %d.%d.%d.%d\n\n",rd.gateway[0],rd.gateway[1],\
+          rd.gateway[2],rd.gateway[3]);
+  printf("Reading SAR: %.2x:%.2x:%.2x:%.2x:%.2x:%.2x\n\n",rd.mac[0],rd.mac[1],\
+          rd.mac[2],rd.mac[3],rd.mac[4],rd.mac[5]);
+  printf("Reading SUBR: %d.%d.%d.%d\n\n",rd.subnet[0],rd.subnet[1],\
+          rd.subnet[2],rd.subnet[3]);
+  printf("Reading SIPR: %d.%d.%d.%d\n\n",rd.ip[0],rd.ip[1],\
+          rd.ip[2],rd.ip[3]);
+  printf("Reading RMSR and TMSR: %.2x %.2x\n\n",w5100_read8(RMSR),w5100_read8(TMSR));
   printf("Done Wiznet W5100 Initialized!\n");
 }
 // Assign I/O stream to UART
@@ -207,13 +119,7 @@ int main(void){
   ansi_cl();
   uart_flush();
   // Initial the AVR ATMega168/328 SPI Peripheral
-  // Set MOSI (PORTB3),SCK (PORTB5) and PORTB2 (SS) as output, others as input
-  SPI_DDR = (1<<PORTB3)|(1<<PORTB5)|(1<<PORTB2);
-  // CS pin is not active
-  SPI_PORT |= (1<<SPI_CS);
-  // Enable SPI, Master Mode 0, set the clock rate fck/2
-  SPCR = (1<<SPE)|(1<<MSTR);
-  SPSR |= (1<<SPI2X);
+  w5100_spi_init();
   // Initial the Wiznet W5100
   printf("Wiznet W5100 Init\n\n");
   W5100_Init();
@@ -0,0 +1,110 @@
+/*****************************************************************************
+//  File Name    : carrier_report.c
+//  Description  : Carrier frequency error over the Pronto range, using the
+//                 firmware's carrier planner and dither
+//  Target       : Linux host
+//
+//  Every Pronto frequency word from lo to hi kHz is planned as on the
+//  board, then a full dither cycle of periods is run through
+//  carrier_step() and timed. The report shows the error against the
+//  frequency the word asks for, with and without dithering. The error
+//  of the word against the nominal frequency is shown as well. That
+//  part is the Pronto format's own rounding and no divider can fix it.
+//
+//  Usage: carrier_report [-l lo_khz] [-h hi_khz] [-d duty] [-q]
+//  Exits non-zero if any word misses by more than 0.1%.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include "carrier.h"
+
+#define PRONTO_TICK_US 0.241246
+#define LIMIT_PCT      0.1
+#define PERIODS        (256 * 16)  // Whole dither cycles
+
+static double word_hz(int w)
+{
+  return 1e6 / (w * PRONTO_TICK_US);
+}
+
+// Run the dither the way the overflow interrupt does and time it
+static void simulate(carrier_t c,double *hz,int *lo,int *hi)
+{
+  double counts = 0;
+  int i,top;
+
+  *lo = 256;
+  *hi = 0;
+  for (i = 0; i < PERIODS; i++) {
+    top = carrier_step(&c);
+    counts += top + 1;
+    if (top < *lo) *lo = top;
+    if (top > *hi) *hi = top;
+  }
+  *hz = (double)F_CPU / (1 << c.shift) * PERIODS / counts;
+}
+
+int main(int argc,char **argv)
+{
+  double lo_khz = 30,hi_khz = 60,hz,target,plain_hz,err,plain_err,worst = 0,worst_plain = 0;
+  int duty = CARRIER_DUTY,quiet = 0,opt,w,w_lo,w_hi,top_lo,top_hi,fails = 0,n = 0;
+  static const double named[] = {36.0,36.7,38.0,40.0,56.0};
+  carrier_t c;
+  unsigned i;
+
+  while ((opt = getopt(argc,argv,"l:h:d:q")) != -1) {
+    switch (opt) {
+      case 'l': lo_khz = atof(optarg); break;
+      case 'h': hi_khz = atof(optarg); break;
+      case 'd': duty = atoi(optarg); break;
+      case 'q': quiet = 1; break;
+      default:
+        fprintf(stderr,"usage: %s [-l lo_khz] [-h hi_khz] [-d duty] [-q]\n",argv[0]);
+        return 1;
+    }
+  }
+
+  // Higher words are lower frequencies
+  w_lo = (int)ceil(1e3 / (hi_khz * PRONTO_TICK_US));
+  w_hi = (int)floor(1e3 / (lo_khz * PRONTO_TICK_US));
+
+  if (!quiet)
+    printf(" word   target Hz  prescale  TOP + frac   dithered Hz   error %%   single TOP Hz   error %%  duty %%\n");
+  for (w = w_lo; w <= w_hi; w++) {
+    if (!carrier_plan(&c,w,duty)) {
+      printf("%04X  out of range\n",w);
+      fails++;
+      continue;
+    }
+    target = word_hz(w);
+    simulate(c,&hz,&top_lo,&top_hi);
+    // The best a fixed divider can do
+    plain_hz = (double)F_CPU / (1 << c.shift) / (c.top + 1 + (c.frac >= 128));
+    err = (hz - target) / target * 100;
+    plain_err = (plain_hz - target) / target * 100;
+    if (fabs(err) > worst) worst = fabs(err);
+    if (fabs(plain_err) > worst_plain) worst_plain = fabs(plain_err);
+    if (fabs(err) > LIMIT_PCT) fails++;
+    n++;
+    if (!quiet)
+      printf("%04X  %10.1f    Clk/%-4d %3d + %3d/256 %11.1f  %+8.4f  %13.1f  %+8.3f  %5.1f%s\n",
+             w,target,1 << c.shift,c.top,c.frac,hz,err,plain_hz,plain_err,
+             100.0 * (c.duty_top + 1) / (c.top + 1 + c.frac / 256.0),
+             fabs(err) > LIMIT_PCT ? "  FAIL" : "");
+  }
+
+  printf("\nnominal kHz   word   word Hz   word error %%   dithered Hz   error vs nominal %%\n");
+  for (i = 0; i < sizeof(named) / sizeof(named[0]); i++) {
+    w = (int)floor(1e3 / (named[i] * PRONTO_TICK_US) + 0.5);
+    if (!carrier_plan(&c,w,duty)) continue;
+    simulate(c,&hz,&top_lo,&top_hi);
+    printf("%11.1f   %04X  %8.1f   %+11.3f   %11.1f   %+17.3f\n",named[i],w,word_hz(w),
+           (word_hz(w) - named[i] * 1000) / (named[i] * 10),hz,(hz - named[i] * 1000) / (named[i] * 10));
+  }
+
+  printf("\n%d words from %.1f to %.1f kHz: worst error %.4f%% dithered, %.3f%% with a single TOP; %d over %.1f%%\n",
+         n,lo_khz,hi_khz,worst,worst_plain,fails,LIMIT_PCT);
+  return fails != 0;
+}
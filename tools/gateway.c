@@ -0,0 +1,1154 @@
+/*****************************************************************************
+//  File Name    : gateway.c
+//  Description  : Gateway daemon holding sessions open to many OpenRemote
+//                 boxes and feeding them commands from local clients
+//  Target       : Linux host
+//
+//  Each device is kept on one TCP session to its frame port, carrying the
+//  same CRC framed commands as the serial channel. Clients connect to a
+//  local unix socket and send one command per line:
+//
+//    send <device> <pronto hex>   decode here, upload and send the code
+//    fire <device>                send the code the device already holds
+//    stats                        one line of counters per device
+//
+//  Every line is answered with its line number on that connection, then
+//  "ok <total ms> <device ms>" or "err <reason>"; answers come back in
+//  completion order. Codes are decoded and checked here and go out as
+//  binary burst tables. A code the device already holds is sent with
+//  FIRE instead of being uploaded again, and identical commands still
+//  waiting for the same device are merged into one. All frames of a
+//  command leave in a single write, with the keepalive riding along.
+//
+//  The emitter on a box is a single channel, so one IR command at a time
+//  is in flight per device and the rest queue here; queue depth, latency
+//  and batching are tracked per device.
+//
+//  With -S n the gateway also runs n simulated devices (sim0, sim1, ...)
+//  on loopback ports. They answer like the firmware and stay busy for as
+//  long as each code would take to send, for load testing without boxes.
+//
+//  Usage: gateway [-s socket] [-q depth] [-m] [-S n] [name=]host[:port] ...
+*****************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include "frame.h"
+
+#define SESSION_PORT     4211     // Frame port on the device
+#define MAX_DEVICES      256
+#define MAX_CLIENTS      256
+#define MAX_WORDS        192      // CODE_MAX on the device, in words
+#define MAX_WAITERS      8        // Requests sharing one merged command
+#define UPLOAD_BYTES     62       // Burst bytes per UPLOAD frame, whole words
+#define EXPECT_MAX       32       // Replies outstanding per device
+#define DEV_OUT          4096
+#define CLIENT_IN        4096
+#define CLIENT_OUT       65536
+
+// Timing, in ms
+#define CONNECT_MS       1000     // Give up on a connect attempt
+#define RECONNECT_MS     1000     // Wait before trying a lost device again
+#define KEEPALIVE_MS     2000     // STATS poll on an idle session
+#define REPLY_MS         1000     // A reply later than this drops the session
+#define BUSY_MS          20       // Retry delay when the emitter is busy
+#define QUEUE_TTL_MS     5000     // Commands waiting longer than this fail
+#define MAX_RETRIES      5
+
+#define PRONTO_TICK_US   0.241246 // Pronto frequency word unit
+
+// epoll tags, high half of the event data
+#define TAG_API          1
+#define TAG_CLIENT       2
+#define TAG_DEVICE       3
+#define TAG_SIM_LISTEN   4
+#define TAG_SIM          5
+
+// Device session states
+#define DEV_DOWN         0
+#define DEV_CONNECTING   1
+#define DEV_UP           2
+
+typedef struct cmd {
+  struct cmd *next;
+  int fire_only;               // Send whatever the device holds
+  int fired;                   // Went out as FIRE rather than UPLOAD
+  uint16_t words[MAX_WORDS];
+  int nwords;
+  uint64_t hash;
+  double duration;             // Time the code takes to send, ms
+  double queued,dispatched;
+  uint8_t status;              // First failure among the replies
+  int retries;
+  int nwait;
+  struct {
+    int client;
+    uint32_t gen;
+    unsigned long line;
+  } wait[MAX_WAITERS];
+} cmd_t;
+
+typedef struct {
+  uint8_t cmd;
+  uint8_t last;                // Final reply for the active command
+  double sent;
+} expect_t;
+
+typedef struct {
+  char name[32];
+  struct sockaddr_in addr;
+  int fd;
+  int state;
+  double when;                 // Reconnect, or connect timeout
+  frame_rx_t rx;
+  uint8_t out[DEV_OUT];
+  int out_len;
+  int frames;                  // Frames in out since the last write
+  expect_t expect[EXPECT_MAX];
+  int exp_head,exp_count;
+  cmd_t *queue,*tail;
+  int depth;
+  cmd_t *active;
+  double hold_until;           // Emitter still sending the last code
+  double idle_at;              // Next keepalive
+  int held;                    // Device holds the code in held_hash
+  uint64_t held_hash;
+  double held_duration;
+  // Counters
+  unsigned long done,failed,merged,uploads,fires,busy,reconnects;
+  unsigned long writes,frames_out;
+  int depth_max;
+  double lat_sum,lat_min,lat_max,rtt;
+  uint8_t stats[15];           // Last STATS reply from the device
+  int have_stats;
+} device_t;
+
+typedef struct {
+  int fd;
+  uint32_t gen;
+  char in[CLIENT_IN];
+  int in_len;
+  char *out;
+  int out_len;
+  unsigned long line;
+} client_t;
+
+// Simulated device, the firmware's frame_command() without the hardware
+typedef struct {
+  int listen_fd,fd;
+  frame_rx_t rx;
+  int uploading;
+  uint16_t word;
+  int half;
+  int index,total;
+  double period_us,sum_us;
+  double code_ms;
+  uint16_t code_len;
+  double busy_until;
+} sim_t;
+
+static device_t devices[MAX_DEVICES];
+static int ndevices;
+static client_t clients[MAX_CLIENTS];
+static uint32_t client_gen;
+static sim_t sims[MAX_DEVICES];
+static int nsims;
+static int ep;
+static int queue_max = 32;
+static int merge = 1;
+static volatile sig_atomic_t stop;
+
+static double now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void on_signal(int sig)
+{
+  stop = 1;
+}
+
+static void ep_set(int op,int fd,int tag,int idx,uint32_t events)
+{
+  struct epoll_event ev;
+
+  ev.events = events;
+  ev.data.u64 = ((uint64_t)tag << 32) | (uint32_t)idx;
+  epoll_ctl(ep,op,fd,&ev);
+}
+
+static uint64_t fnv64(const uint16_t *w,int n)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    h = (h ^ (w[i] >> 8)) * 0x100000001b3ULL;
+    h = (h ^ (w[i] & 0xFF)) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// Decode Pronto hex into c->words; returns an error or NULL. Only the
+// learned format (0000) is accepted, as that is all the emitter plays.
+static const char *pronto_parse(const char *s,cmd_t *c)
+{
+  uint16_t w = 0;
+  int nib = 0,n,i;
+  double period,sum = 0;
+
+  c->nwords = 0;
+  for (; *s; s++) {
+    if (isxdigit((unsigned char)*s)) {
+      w = (w << 4) | (isdigit((unsigned char)*s) ? *s - '0' : (tolower((unsigned char)*s) - 'a' + 10));
+      if (++nib == 4) {
+        if (c->nwords == MAX_WORDS) return "code too long";
+        c->words[c->nwords++] = w;
+        w = 0;
+        nib = 0;
+      }
+    } else if (*s == ' ' || *s == '\t' || *s == '+' || *s == '\r') {
+      if (nib) return "bad word";
+    } else {
+      return "bad character";
+    }
+  }
+  if (nib) return "bad word";
+  if (c->nwords < 4) return "code too short";
+  if (c->words[0] != 0x0000) return "not a learned code";
+  if (c->words[1] == 0) return "bad frequency";
+  n = 4 + 2 * (c->words[2] + c->words[3]);
+  if (n > MAX_WORDS) return "code too long";
+  if (c->nwords < n) return "code truncated";
+  // The device ignores anything past the burst pairs too
+  c->nwords = n;
+
+  period = c->words[1] * PRONTO_TICK_US;
+  for (i = 4; i < n; i++)
+    sum += c->words[i];
+  c->duration = sum * period / 1000.0;
+  c->hash = fnv64(c->words,c->nwords);
+  return NULL;
+}
+
+static const char *status_name(uint8_t status)
+{
+  switch (status) {
+    case STATUS_OK: return "ok";
+    case STATUS_BUSY: return "busy";
+    case STATUS_NO_CODE: return "no code";
+    case STATUS_BAD: return "rejected";
+  }
+  return "lost";
+}
+
+/*****************************************************************************
+// Local API clients
+*****************************************************************************/
+static void client_close(client_t *cl)
+{
+  if (cl->fd < 0) return;
+  epoll_ctl(ep,EPOLL_CTL_DEL,cl->fd,NULL);
+  close(cl->fd);
+  cl->fd = -1;
+  free(cl->out);
+  cl->out = NULL;
+}
+
+static void client_flush(client_t *cl)
+{
+  int n;
+
+  if (cl->fd < 0 || cl->out_len == 0) return;
+  n = write(cl->fd,cl->out,cl->out_len);
+  if (n < 0) {
+    if (errno != EAGAIN) client_close(cl);
+    return;
+  }
+  memmove(cl->out,cl->out + n,cl->out_len - n);
+  cl->out_len -= n;
+  ep_set(EPOLL_CTL_MOD,cl->fd,TAG_CLIENT,cl - clients,EPOLLIN | (cl->out_len ? EPOLLOUT : 0));
+}
+
+static void client_printf(client_t *cl,const char *fmt,...)
+{
+  va_list ap;
+  int n;
+
+  if (cl->fd < 0) return;
+  va_start(ap,fmt);
+  n = vsnprintf(cl->out + cl->out_len,CLIENT_OUT - cl->out_len,fmt,ap);
+  va_end(ap);
+  // A client that stops reading loses its connection, not our memory
+  if (n >= CLIENT_OUT - cl->out_len) {
+    client_close(cl);
+    return;
+  }
+  cl->out_len += n;
+}
+
+static void client_accept(int api)
+{
+  client_t *cl;
+  int fd,i;
+
+  fd = accept4(api,NULL,NULL,SOCK_NONBLOCK);
+  if (fd < 0) return;
+  for (i = 0; i < MAX_CLIENTS && clients[i].fd >= 0; i++)
+    ;
+  if (i == MAX_CLIENTS) {
+    close(fd);
+    return;
+  }
+  cl = &clients[i];
+  cl->fd = fd;
+  cl->gen = ++client_gen;
+  cl->in_len = 0;
+  cl->out = malloc(CLIENT_OUT);
+  cl->out_len = 0;
+  cl->line = 0;
+  ep_set(EPOLL_CTL_ADD,fd,TAG_CLIENT,i,EPOLLIN);
+}
+
+// Answer every request merged into c
+static void cmd_reply(cmd_t *c,const char *fmt,...)
+{
+  char msg[128];
+  va_list ap;
+  client_t *cl;
+  int i;
+
+  va_start(ap,fmt);
+  vsnprintf(msg,sizeof(msg),fmt,ap);
+  va_end(ap);
+  for (i = 0; i < c->nwait; i++) {
+    cl = &clients[c->wait[i].client];
+    if (cl->fd < 0 || cl->gen != c->wait[i].gen) continue;
+    client_printf(cl,"%lu %s\n",c->wait[i].line,msg);
+    client_flush(cl);
+  }
+}
+
+/*****************************************************************************
+// Device sessions
+*****************************************************************************/
+static void dev_pump(device_t *d);
+
+static void dev_push_front(device_t *d,cmd_t *c)
+{
+  c->next = d->queue;
+  d->queue = c;
+  if (d->tail == NULL)
+    d->tail = c;
+  d->depth++;
+}
+
+static void dev_fail(device_t *d,cmd_t *c,const char *why)
+{
+  d->failed++;
+  cmd_reply(c,"err %s",why);
+  free(c);
+}
+
+static void dev_drop(device_t *d)
+{
+  cmd_t *c;
+
+  if (d->fd >= 0) {
+    epoll_ctl(ep,EPOLL_CTL_DEL,d->fd,NULL);
+    close(d->fd);
+    d->fd = -1;
+  }
+  if (d->state == DEV_UP) {
+    fprintf(stderr,"%s: session lost\n",d->name);
+    d->reconnects++;
+  }
+  d->state = DEV_DOWN;
+  d->when = now_ms() + RECONNECT_MS;
+  // It may have rebooted; upload the next code in full
+  d->held = 0;
+  d->exp_count = 0;
+  d->out_len = 0;
+  d->frames = 0;
+  if ((c = d->active) != NULL) {
+    d->active = NULL;
+    if (++c->retries > MAX_RETRIES)
+      dev_fail(d,c,"lost");
+    else
+      dev_push_front(d,c);
+  }
+}
+
+static void dev_flush(device_t *d)
+{
+  int n;
+
+  if (d->state != DEV_UP || d->out_len == 0) return;
+  n = write(d->fd,d->out,d->out_len);
+  if (n < 0) {
+    if (errno != EAGAIN) dev_drop(d);
+    return;
+  }
+  d->writes++;
+  d->frames_out += d->frames;
+  d->frames = 0;
+  memmove(d->out,d->out + n,d->out_len - n);
+  d->out_len -= n;
+  ep_set(EPOLL_CTL_MOD,d->fd,TAG_DEVICE,d - devices,EPOLLIN | (d->out_len ? EPOLLOUT : 0));
+}
+
+// Queue a frame for the next write and note the reply it will get
+static void dev_frame(device_t *d,uint8_t cmd,const uint8_t *payload,uint8_t len,uint8_t last)
+{
+  expect_t *e;
+
+  e = &d->expect[(d->exp_head + d->exp_count++) % EXPECT_MAX];
+  e->cmd = cmd;
+  e->last = last;
+  e->sent = now_ms();
+  d->out_len += frame_build(d->out + d->out_len,cmd,payload,len);
+  d->frames++;
+}
+
+static void dev_upload(device_t *d,cmd_t *c)
+{
+  uint8_t payload[FRAME_MAX];
+  int bytes = c->nwords * 2,off,n,i;
+
+  for (off = 0; off < bytes; off += n) {
+    n = bytes - off;
+    if (n > UPLOAD_BYTES)
+      n = UPLOAD_BYTES;
+    payload[0] = (off == 0 ? UPLOAD_FIRST : 0) | (off + n == bytes ? UPLOAD_LAST : 0);
+    for (i = 0; i < n; i += 2) {
+      payload[1 + i] = c->words[(off + i) / 2] >> 8;
+      payload[2 + i] = c->words[(off + i) / 2] & 0xFF;
+    }
+    dev_frame(d,CMD_UPLOAD,payload,n + 1,off + n == bytes);
+  }
+}
+
+// Start the next queued command if the device is free for it
+static void dev_pump(device_t *d)
+{
+  cmd_t *c;
+  double now;
+
+  if (d->state != DEV_UP || d->active != NULL || d->queue == NULL) return;
+  now = now_ms();
+  if (now < d->hold_until) return;
+  // Room for a full upload plus the keepalive
+  if (d->exp_count + (MAX_WORDS * 2 + UPLOAD_BYTES - 1) / UPLOAD_BYTES + 1 > EXPECT_MAX) return;
+
+  c = d->queue;
+  d->queue = c->next;
+  if (d->queue == NULL)
+    d->tail = NULL;
+  d->depth--;
+  d->active = c;
+  c->status = STATUS_OK;
+  c->dispatched = now;
+  c->fired = c->fire_only || (d->held && d->held_hash == c->hash);
+  if (c->fired) {
+    dev_frame(d,CMD_FIRE,NULL,0,1);
+    d->fires++;
+  } else {
+    dev_upload(d,c);
+    d->uploads++;
+  }
+  d->idle_at = now + KEEPALIVE_MS;
+  dev_flush(d);
+}
+
+// The last reply for the active command is in
+static void dev_finish(device_t *d)
+{
+  cmd_t *c = d->active;
+  double now = now_ms(),lat;
+
+  d->active = NULL;
+  if (c->status == STATUS_BUSY && c->retries < MAX_RETRIES) {
+    // Something else started the emitter; try again shortly
+    c->retries++;
+    d->busy++;
+    d->hold_until = now + BUSY_MS;
+    dev_push_front(d,c);
+    return;
+  }
+  if (c->status == STATUS_NO_CODE && c->fired && !c->fire_only) {
+    // The device lost the code, a reboot most likely; upload it
+    d->held = 0;
+    dev_push_front(d,c);
+    dev_pump(d);
+    return;
+  }
+  if (c->status != STATUS_OK) {
+    if (!c->fired)
+      d->held = 0;
+    dev_fail(d,c,status_name(c->status));
+    dev_pump(d);
+    return;
+  }
+
+  if (!c->fired) {
+    d->held = 1;
+    d->held_hash = c->hash;
+    d->held_duration = c->duration;
+  }
+  // The reply comes as the code starts; the emitter is busy until it ends
+  d->hold_until = now + (c->fire_only ? d->held_duration : c->duration);
+  lat = now - c->dispatched;
+  d->lat_sum += lat;
+  if (d->done == 0 || lat < d->lat_min)
+    d->lat_min = lat;
+  if (lat > d->lat_max)
+    d->lat_max = lat;
+  d->done++;
+  cmd_reply(c,"ok %.3f %.3f",now - c->queued,lat);
+  free(c);
+  dev_pump(d);
+}
+
+// Match a reply to the oldest frame still waiting for one
+static void dev_reply(device_t *d,frame_rx_t *f)
+{
+  expect_t *e;
+
+  if (d->exp_count == 0) goto bad;
+  e = &d->expect[d->exp_head];
+  if (f->cmd != (e->cmd | FRAME_REPLY)) goto bad;
+  d->exp_head = (d->exp_head + 1) % EXPECT_MAX;
+  d->exp_count--;
+
+  switch (e->cmd) {
+    case CMD_STATS:
+      if (f->len >= sizeof(d->stats)) {
+        memcpy(d->stats,f->payload,sizeof(d->stats));
+        d->have_stats = 1;
+      }
+      // fall through
+    case CMD_PING:
+      d->rtt = now_ms() - e->sent;
+      break;
+    default:
+      if (d->active == NULL || f->len < 1) goto bad;
+      if (d->active->status == STATUS_OK)
+        d->active->status = f->payload[0];
+      if (e->last)
+        dev_finish(d);
+      break;
+  }
+  return;
+
+bad:
+  fprintf(stderr,"%s: unexpected reply %02x\n",d->name,f->cmd);
+  dev_drop(d);
+}
+
+static void dev_read(device_t *d)
+{
+  uint8_t buf[4096];
+  int n,i;
+
+  n = read(d->fd,buf,sizeof(buf));
+  if (n == 0 || (n < 0 && errno != EAGAIN)) {
+    dev_drop(d);
+    return;
+  }
+  for (i = 0; i < n; i++) {
+    if (!frame_rx(&d->rx,buf[i])) continue;
+    dev_reply(d,&d->rx);
+    // A reply can end the session, from a mismatch or a failed write
+    if (d->state != DEV_UP) return;
+  }
+  dev_flush(d);
+}
+
+static void dev_connect(device_t *d)
+{
+  int fd,one = 1;
+
+  d->when = now_ms() + RECONNECT_MS;
+  fd = socket(AF_INET,SOCK_STREAM | SOCK_NONBLOCK,0);
+  if (fd < 0) return;
+  setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+  if (connect(fd,(struct sockaddr *)&d->addr,sizeof(d->addr)) < 0 && errno != EINPROGRESS) {
+    close(fd);
+    return;
+  }
+  d->fd = fd;
+  d->state = DEV_CONNECTING;
+  d->when = now_ms() + CONNECT_MS;
+  ep_set(EPOLL_CTL_ADD,fd,TAG_DEVICE,d - devices,EPOLLOUT);
+}
+
+static void dev_connected(device_t *d)
+{
+  int err = 0;
+  socklen_t len = sizeof(err);
+
+  getsockopt(d->fd,SOL_SOCKET,SO_ERROR,&err,&len);
+  if (err) {
+    dev_drop(d);
+    return;
+  }
+  fprintf(stderr,"%s: session up\n",d->name);
+  d->state = DEV_UP;
+  frame_init(&d->rx);
+  d->exp_head = 0;
+  d->exp_count = 0;
+  d->out_len = 0;
+  d->hold_until = 0;
+  ep_set(EPOLL_CTL_MOD,d->fd,TAG_DEVICE,d - devices,EPOLLIN);
+  dev_frame(d,CMD_STATS,NULL,0,0);
+  d->idle_at = now_ms() + KEEPALIVE_MS;
+  dev_pump(d);
+  dev_flush(d);
+}
+
+// Reconnects, keepalives, reply timeouts, retries and stale commands
+static void dev_timers(device_t *d,double now)
+{
+  cmd_t *c,*prev,*next;
+
+  switch (d->state) {
+    case DEV_DOWN:
+      if (now >= d->when)
+        dev_connect(d);
+      break;
+    case DEV_CONNECTING:
+      if (now >= d->when)
+        dev_drop(d);
+      break;
+    case DEV_UP:
+      if (d->exp_count && now - d->expect[d->exp_head].sent > REPLY_MS) {
+        fprintf(stderr,"%s: no reply\n",d->name);
+        dev_drop(d);
+        break;
+      }
+      if (now >= d->idle_at && d->exp_count < EXPECT_MAX) {
+        dev_frame(d,CMD_STATS,NULL,0,0);
+        d->idle_at = now + KEEPALIVE_MS;
+        dev_flush(d);
+      }
+      dev_pump(d);
+      break;
+  }
+
+  prev = NULL;
+  for (c = d->queue; c != NULL; c = next) {
+    next = c->next;
+    if (now - c->queued < QUEUE_TTL_MS) {
+      prev = c;
+      continue;
+    }
+    if (prev != NULL)
+      prev->next = next;
+    else
+      d->queue = next;
+    if (d->tail == c)
+      d->tail = prev;
+    d->depth--;
+    dev_fail(d,c,"timeout");
+  }
+}
+
+// Earliest time any device needs its timers run
+static double dev_deadline(void)
+{
+  device_t *d;
+  double t = now_ms() + 1000;
+  int i;
+
+  for (i = 0; i < ndevices; i++) {
+    d = &devices[i];
+    if (d->state != DEV_UP) {
+      if (d->when < t) t = d->when;
+      continue;
+    }
+    if (d->idle_at < t) t = d->idle_at;
+    if (d->exp_count && d->expect[d->exp_head].sent + REPLY_MS < t)
+      t = d->expect[d->exp_head].sent + REPLY_MS;
+    if (d->queue != NULL && d->active == NULL && d->hold_until < t)
+      t = d->hold_until;
+    if (d->queue != NULL && d->queue->queued + QUEUE_TTL_MS < t)
+      t = d->queue->queued + QUEUE_TTL_MS;
+  }
+  return t;
+}
+
+static device_t *dev_find(const char *name)
+{
+  int i;
+
+  for (i = 0; i < ndevices; i++) {
+    if (strcmp(devices[i].name,name) == 0)
+      return &devices[i];
+  }
+  return NULL;
+}
+
+static int dev_add(const char *name,struct in_addr ip,int port)
+{
+  device_t *d;
+
+  if (ndevices == MAX_DEVICES) return -1;
+  d = &devices[ndevices];
+  memset(d,0,sizeof(*d));
+  snprintf(d->name,sizeof(d->name),"%s",name);
+  d->addr.sin_family = AF_INET;
+  d->addr.sin_addr = ip;
+  d->addr.sin_port = htons(port);
+  d->fd = -1;
+  d->state = DEV_DOWN;
+  d->when = 0;
+  return ndevices++;
+}
+
+// Add or merge a command for d on behalf of one client request
+static void dev_enqueue(device_t *d,cmd_t *c,client_t *cl)
+{
+  cmd_t *q;
+
+  if (merge) {
+    for (q = d->queue; q != NULL; q = q->next) {
+      if (q->fire_only != c->fire_only || q->hash != c->hash || q->nwords != c->nwords) continue;
+      if (memcmp(q->words,c->words,c->nwords * sizeof(uint16_t)) != 0 || q->nwait == MAX_WAITERS) continue;
+      q->wait[q->nwait].client = cl - clients;
+      q->wait[q->nwait].gen = cl->gen;
+      q->wait[q->nwait++].line = cl->line;
+      d->merged++;
+      free(c);
+      return;
+    }
+  }
+
+  c->wait[0].client = cl - clients;
+  c->wait[0].gen = cl->gen;
+  c->wait[0].line = cl->line;
+  c->nwait = 1;
+  if (d->depth >= queue_max) {
+    dev_fail(d,c,"queue full");
+    return;
+  }
+  c->queued = now_ms();
+  c->next = NULL;
+  if (d->tail != NULL)
+    d->tail->next = c;
+  else
+    d->queue = c;
+  d->tail = c;
+  if (++d->depth > d->depth_max)
+    d->depth_max = d->depth;
+  dev_pump(d);
+}
+
+static void dev_stats(client_t *cl,device_t *d)
+{
+  static const char *states[] = {"down","connecting","up"};
+  uint8_t *s = d->stats;
+
+  client_printf(cl,"%lu %s %s depth %d max %d done %lu failed %lu merged %lu uploads %lu fires %lu busy %lu",
+                cl->line,d->name,states[d->state],d->depth,d->depth_max,d->done,d->failed,
+                d->merged,d->uploads,d->fires,d->busy);
+  client_printf(cl," ms %.2f/%.2f/%.2f rtt %.2f frames/write %.2f reconnects %lu",
+                d->done ? d->lat_min : 0,d->done ? d->lat_sum / d->done : 0,d->lat_max,d->rtt,
+                d->writes ? (double)d->frames_out / d->writes : 0,d->reconnects);
+  if (d->have_stats) {
+    client_printf(cl," code %u edge_us %u underruns %u crc %u",
+                  (s[1] << 8) | s[2],
+                  (unsigned)(((uint32_t)s[5] << 24) | (s[6] << 16) | (s[7] << 8) | s[8]),
+                  (s[9] << 8) | s[10],(s[11] << 8) | s[12]);
+  }
+  client_printf(cl,"\n");
+}
+
+/*****************************************************************************
+// Request lines
+*****************************************************************************/
+static char *next_token(char **p)
+{
+  char *t;
+
+  *p += strspn(*p," \t\r");
+  if (**p == 0) return NULL;
+  t = *p;
+  *p += strcspn(*p," \t\r");
+  if (**p)
+    *(*p)++ = 0;
+  return t;
+}
+
+static void client_line(client_t *cl,char *line)
+{
+  char *p = line,*verb,*name;
+  const char *err;
+  device_t *d;
+  cmd_t *c;
+  int i;
+
+  if ((verb = next_token(&p)) == NULL) return;
+  cl->line++;
+
+  if (strcmp(verb,"stats") == 0) {
+    for (i = 0; i < ndevices; i++)
+      dev_stats(cl,&devices[i]);
+    client_printf(cl,"%lu end\n",cl->line);
+    return;
+  }
+  if (strcmp(verb,"send") != 0 && strcmp(verb,"fire") != 0) {
+    client_printf(cl,"%lu err unknown command\n",cl->line);
+    return;
+  }
+  if ((name = next_token(&p)) == NULL || (d = dev_find(name)) == NULL) {
+    client_printf(cl,"%lu err unknown device\n",cl->line);
+    return;
+  }
+
+  c = calloc(1,sizeof(*c));
+  if (verb[0] == 'f') {
+    c->fire_only = 1;
+  } else if ((err = pronto_parse(p,c)) != NULL) {
+    client_printf(cl,"%lu err %s\n",cl->line,err);
+    free(c);
+    return;
+  }
+  dev_enqueue(d,c,cl);
+}
+
+static void client_read(client_t *cl)
+{
+  char *nl,*start;
+  int n;
+
+  n = read(cl->fd,cl->in + cl->in_len,CLIENT_IN - 1 - cl->in_len);
+  if (n == 0 || (n < 0 && errno != EAGAIN)) {
+    client_close(cl);
+    return;
+  }
+  if (n < 0) return;
+  cl->in_len += n;
+  cl->in[cl->in_len] = 0;
+
+  start = cl->in;
+  while (cl->fd >= 0 && (nl = strchr(start,'\n')) != NULL) {
+    *nl = 0;
+    client_line(cl,start);
+    start = nl + 1;
+  }
+  if (cl->fd < 0) return;
+  cl->in_len -= start - cl->in;
+  memmove(cl->in,start,cl->in_len);
+  if (cl->in_len == CLIENT_IN - 1) {
+    client_printf(cl,"%lu err line too long\n",++cl->line);
+    cl->in_len = 0;
+  }
+  client_flush(cl);
+}
+
+/*****************************************************************************
+// Simulated devices
+*****************************************************************************/
+static int sim_open(void)
+{
+  struct sockaddr_in a;
+  socklen_t len = sizeof(a);
+  sim_t *s = &sims[nsims];
+  int fd,one = 1;
+
+  fd = socket(AF_INET,SOCK_STREAM | SOCK_NONBLOCK,0);
+  setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&one,sizeof(one));
+  memset(&a,0,sizeof(a));
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(fd,(struct sockaddr *)&a,sizeof(a)) < 0 || listen(fd,1) < 0) {
+    perror("simulated device");
+    exit(1);
+  }
+  getsockname(fd,(struct sockaddr *)&a,&len);
+  memset(s,0,sizeof(*s));
+  s->listen_fd = fd;
+  s->fd = -1;
+  ep_set(EPOLL_CTL_ADD,fd,TAG_SIM_LISTEN,nsims++,EPOLLIN);
+  return ntohs(a.sin_port);
+}
+
+static void sim_accept(sim_t *s)
+{
+  int fd,one = 1;
+
+  fd = accept4(s->listen_fd,NULL,NULL,SOCK_NONBLOCK);
+  if (fd < 0) return;
+  // One session at a time, as on the W5100
+  if (s->fd >= 0) {
+    epoll_ctl(ep,EPOLL_CTL_DEL,s->fd,NULL);
+    close(s->fd);
+  }
+  setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+  s->fd = fd;
+  s->uploading = 0;
+  frame_init(&s->rx);
+  ep_set(EPOLL_CTL_ADD,fd,TAG_SIM,s - sims,EPOLLIN);
+}
+
+// One Pronto word, tracked only as far as timing the code
+static void sim_word(sim_t *s,uint16_t w)
+{
+  if (s->index >= s->total) return;
+  if (s->index == 1)
+    s->period_us = w * PRONTO_TICK_US;
+  else if (s->index == 2 || s->index == 3)
+    s->total += 2 * w;
+  else if (s->index >= 4)
+    s->sum_us += w * s->period_us;
+  s->index++;
+  s->code_len += 2;
+}
+
+static uint8_t sim_command(sim_t *s,frame_rx_t *f)
+{
+  uint8_t *p = f->payload;
+  uint8_t status = STATUS_OK,flags;
+  double now = now_ms();
+  int busy = now < s->busy_until,i;
+
+  switch (f->cmd) {
+    case CMD_PING:
+      return f->len;
+    case CMD_FIRE:
+      if (busy)
+        status = STATUS_BUSY;
+      else if (s->code_len == 0)
+        status = STATUS_NO_CODE;
+      else
+        s->busy_until = now + s->code_ms;
+      break;
+    case CMD_UPLOAD:
+      if (f->len == 0) {
+        status = STATUS_BAD;
+        break;
+      }
+      flags = p[0];
+      if (flags & UPLOAD_FIRST) {
+        if (busy) {
+          status = STATUS_BUSY;
+          break;
+        }
+        s->uploading = 1;
+        s->index = 0;
+        s->total = 4;
+        s->half = 0;
+        s->sum_us = 0;
+        s->code_len = 0;
+      }
+      if (!s->uploading) {
+        status = STATUS_BAD;
+        break;
+      }
+      for (i = 1; i < f->len; i++) {
+        s->word = (s->word << 8) | p[i];
+        if (++s->half == 2) {
+          sim_word(s,s->word);
+          s->half = 0;
+        }
+      }
+      if (flags & UPLOAD_LAST) {
+        s->uploading = 0;
+        s->code_ms = s->sum_us / 1000.0;
+        s->busy_until = now + s->code_ms;
+      }
+      break;
+    case CMD_STATS:
+      memset(p,0,15);
+      p[1] = s->code_len >> 8;
+      p[2] = s->code_len & 0xFF;
+      p[11] = f->errors >> 8;
+      p[12] = f->errors & 0xFF;
+      return 15;
+    default:
+      status = STATUS_BAD;
+      break;
+  }
+  p[0] = status;
+  return 1;
+}
+
+// Like session_poll() in the firmware: handle all that arrived, reply once
+static void sim_read(sim_t *s)
+{
+  uint8_t in[2048],out[4096];
+  int n,i,out_len = 0;
+  uint8_t len;
+
+  n = read(s->fd,in,sizeof(in));
+  if (n <= 0) {
+    if (n < 0 && errno == EAGAIN) return;
+    epoll_ctl(ep,EPOLL_CTL_DEL,s->fd,NULL);
+    close(s->fd);
+    s->fd = -1;
+    return;
+  }
+  for (i = 0; i < n; i++) {
+    if (!frame_rx(&s->rx,in[i])) continue;
+    len = sim_command(s,&s->rx);
+    out_len += frame_build(out + out_len,s->rx.cmd | FRAME_REPLY,s->rx.payload,len);
+    if (out_len > (int)sizeof(out) - (FRAME_MAX + FRAME_OVERHEAD)) {
+      if (write(s->fd,out,out_len) < 0) break;
+      out_len = 0;
+    }
+  }
+  if (out_len > 0 && write(s->fd,out,out_len) < 0)
+    perror("simulated device");
+}
+
+/*****************************************************************************
+// Main
+*****************************************************************************/
+static int parse_device(char *arg)
+{
+  struct addrinfo hints,*res;
+  char *name = arg,*host,*port;
+  struct in_addr ip;
+  int p = SESSION_PORT;
+
+  host = strchr(arg,'=');
+  if (host != NULL)
+    *host++ = 0;
+  else
+    host = arg;
+  port = strchr(host,':');
+  if (port != NULL) {
+    *port++ = 0;
+    p = atoi(port);
+  }
+  memset(&hints,0,sizeof(hints));
+  hints.ai_family = AF_INET;
+  if (getaddrinfo(host,NULL,&hints,&res) != 0) {
+    fprintf(stderr,"unknown host %s\n",host);
+    return -1;
+  }
+  ip = ((struct sockaddr_in *)res->ai_addr)->sin_addr;
+  freeaddrinfo(res);
+  return dev_add(name,ip,p);
+}
+
+int main(int argc,char **argv)
+{
+  const char *path = "/tmp/openremote.sock";
+  struct epoll_event events[64];
+  struct sockaddr_un sun;
+  struct in_addr lo;
+  char name[32];
+  int api,opt,nsim = 0,n,i,tag,idx,timeout;
+  uint32_t ev;
+  device_t *d;
+
+  while ((opt = getopt(argc,argv,"s:q:mS:")) != -1) {
+    switch (opt) {
+      case 's': path = optarg; break;
+      case 'q': queue_max = atoi(optarg); break;
+      case 'm': merge = 0; break;
+      case 'S': nsim = atoi(optarg); break;
+      default:
+        fprintf(stderr,"usage: %s [-s socket] [-q depth] [-m] [-S n] [name=]host[:port] ...\n",argv[0]);
+        return 1;
+    }
+  }
+
+  signal(SIGPIPE,SIG_IGN);
+  signal(SIGINT,on_signal);
+  signal(SIGTERM,on_signal);
+  ep = epoll_create1(0);
+  for (i = 0; i < MAX_CLIENTS; i++)
+    clients[i].fd = -1;
+
+  for (i = optind; i < argc; i++) {
+    if (parse_device(argv[i]) < 0) return 1;
+  }
+  lo.s_addr = htonl(INADDR_LOOPBACK);
+  for (i = 0; i < nsim && ndevices < MAX_DEVICES; i++) {
+    snprintf(name,sizeof(name),"sim%d",i);
+    dev_add(name,lo,sim_open());
+  }
+  if (ndevices == 0) {
+    fprintf(stderr,"no devices\n");
+    return 1;
+  }
+
+  api = socket(AF_UNIX,SOCK_STREAM | SOCK_NONBLOCK,0);
+  memset(&sun,0,sizeof(sun));
+  sun.sun_family = AF_UNIX;
+  snprintf(sun.sun_path,sizeof(sun.sun_path),"%s",path);
+  unlink(path);
+  if (bind(api,(struct sockaddr *)&sun,sizeof(sun)) < 0 || listen(api,16) < 0) {
+    perror(path);
+    return 1;
+  }
+  ep_set(EPOLL_CTL_ADD,api,TAG_API,0,EPOLLIN);
+  fprintf(stderr,"%d devices, api on %s\n",ndevices,path);
+
+  while (!stop) {
+    timeout = (int)(dev_deadline() - now_ms()) + 1;
+    if (timeout < 0)
+      timeout = 0;
+    n = epoll_wait(ep,events,64,timeout);
+    for (i = 0; i < n; i++) {
+      tag = events[i].data.u64 >> 32;
+      idx = events[i].data.u64 & 0xFFFFFFFF;
+      ev = events[i].events;
+      switch (tag) {
+        case TAG_API:
+          client_accept(api);
+          break;
+        case TAG_CLIENT:
+          if (ev & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            client_read(&clients[idx]);
+          if (ev & EPOLLOUT)
+            client_flush(&clients[idx]);
+          break;
+        case TAG_DEVICE:
+          d = &devices[idx];
+          if (d->state == DEV_CONNECTING) {
+            dev_connected(d);
+            break;
+          }
+          if (d->state != DEV_UP) break;
+          if (ev & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            dev_read(d);
+          if ((ev & EPOLLOUT) && d->state == DEV_UP)
+            dev_flush(d);
+          break;
+        case TAG_SIM_LISTEN:
+          sim_accept(&sims[idx]);
+          break;
+        case TAG_SIM:
+          if (sims[idx].fd >= 0)
+            sim_read(&sims[idx]);
+          break;
+      }
+    }
+    for (i = 0; i < ndevices; i++)
+      dev_timers(&devices[i],now_ms());
+  }
+
+  unlink(path);
+  return 0;
+}
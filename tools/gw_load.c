@@ -0,0 +1,163 @@
+/*****************************************************************************
+//  File Name    : gw_load.c
+//  Description  : Load generator for the gateway daemon
+//  Target       : Linux host
+//
+//  Opens a number of API connections to the gateway and keeps a window of
+//  send requests outstanding on each, spread over the devices, then
+//  reports throughput and the latency seen by the clients. Run against
+//  "gateway -S n" to load test without hardware.
+//
+//  Usage: gw_load [-s socket] [-c clients] [-n requests] [-w window]
+//                 [-d devices] [-p prefix] [-u] [code]
+//  -u changes the last burst word of every code so nothing is merged or
+//  sent by FIRE.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define MAX_CLIENTS 256
+
+typedef struct {
+  int fd;
+  int sent,answered;
+  double *start;               // Send time by line number
+  char in[4096];
+  int in_len;
+} conn_t;
+
+static double now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int cmp_double(const void *a,const void *b)
+{
+  double x = *(const double *)a,y = *(const double *)b;
+
+  return (x > y) - (x < y);
+}
+
+int main(int argc,char **argv)
+{
+  const char *path = "/tmp/openremote.sock";
+  const char *prefix = "sim";
+  // Short raw code, about 68 ms at 38 kHz
+  const char *code = "0000 006D 0002 0000 0156 00AB 0015 0800";
+  int nclients = 4,requests = 100,window = 4,ndev = 4,unique = 0;
+  static conn_t conns[MAX_CLIENTS];
+  struct pollfd pfd[MAX_CLIENTS];
+  struct sockaddr_un sun;
+  char line[4200],*p,*nl;
+  double *lat,start,elapsed;
+  int opt,i,n,total,ok = 0,err = 0,done = 0,lineno,k;
+
+  while ((opt = getopt(argc,argv,"s:c:n:w:d:p:u")) != -1) {
+    switch (opt) {
+      case 's': path = optarg; break;
+      case 'c': nclients = atoi(optarg); break;
+      case 'n': requests = atoi(optarg); break;
+      case 'w': window = atoi(optarg); break;
+      case 'd': ndev = atoi(optarg); break;
+      case 'p': prefix = optarg; break;
+      case 'u': unique = 1; break;
+      default:
+        fprintf(stderr,"usage: %s [-s socket] [-c clients] [-n requests] [-w window] [-d devices] [-p prefix] [-u] [code]\n",argv[0]);
+        return 1;
+    }
+  }
+  if (optind < argc)
+    code = argv[optind];
+  if (nclients > MAX_CLIENTS) nclients = MAX_CLIENTS;
+  if (unique && strlen(code) < 4) unique = 0;
+
+  total = nclients * requests;
+  lat = calloc(total,sizeof(double));
+  memset(&sun,0,sizeof(sun));
+  sun.sun_family = AF_UNIX;
+  snprintf(sun.sun_path,sizeof(sun.sun_path),"%s",path);
+  for (i = 0; i < nclients; i++) {
+    conns[i].start = calloc(requests,sizeof(double));
+    conns[i].fd = socket(AF_UNIX,SOCK_STREAM,0);
+    if (connect(conns[i].fd,(struct sockaddr *)&sun,sizeof(sun)) < 0) {
+      perror(path);
+      return 1;
+    }
+  }
+
+  start = now_ms();
+  while (done < total) {
+    for (i = 0; i < nclients; i++) {
+      conn_t *c = &conns[i];
+
+      // Top up the window
+      while (c->sent < requests && c->sent - c->answered < window) {
+        k = (i + c->sent) % ndev;
+        if (unique)
+          n = snprintf(line,sizeof(line),"send %s%d %.*s%04X\n",prefix,k,(int)strlen(code) - 4,code,
+                       0x0400 + ((i * requests + c->sent) & 0x3FF));
+        else
+          n = snprintf(line,sizeof(line),"send %s%d %s\n",prefix,k,code);
+        c->start[c->sent] = now_ms();
+        if (write(c->fd,line,n) != n) {
+          perror("write");
+          return 1;
+        }
+        c->sent++;
+      }
+      pfd[i].fd = c->fd;
+      pfd[i].events = POLLIN;
+    }
+    if (poll(pfd,nclients,10000) <= 0) {
+      fprintf(stderr,"gateway stopped answering\n");
+      break;
+    }
+
+    for (i = 0; i < nclients; i++) {
+      conn_t *c = &conns[i];
+
+      if (!(pfd[i].revents & POLLIN)) continue;
+      n = read(c->fd,c->in + c->in_len,sizeof(c->in) - 1 - c->in_len);
+      if (n <= 0) {
+        fprintf(stderr,"gateway closed the connection\n");
+        return 1;
+      }
+      c->in_len += n;
+      c->in[c->in_len] = 0;
+      p = c->in;
+      while ((nl = strchr(p,'\n')) != NULL) {
+        *nl = 0;
+        lineno = atoi(p);
+        if (strstr(p," ok ") != NULL)
+          ok++;
+        else
+          err++;
+        if (lineno > 0 && lineno <= requests)
+          lat[done] = now_ms() - c->start[lineno - 1];
+        done++;
+        c->answered++;
+        p = nl + 1;
+      }
+      c->in_len -= p - c->in;
+      memmove(c->in,p,c->in_len);
+    }
+  }
+  elapsed = now_ms() - start;
+
+  qsort(lat,done,sizeof(double),cmp_double);
+  printf("%d requests, %d ok, %d failed in %.1f ms, %.1f/s\n",done,ok,err,elapsed,done * 1000.0 / elapsed);
+  if (done > 0)
+    printf("latency ms: p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",lat[done / 2],lat[done * 9 / 10],
+           lat[done * 99 / 100],lat[done - 1]);
+  free(lat);
+  return 0;
+}
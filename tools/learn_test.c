@@ -0,0 +1,110 @@
+/*****************************************************************************
+//  File Name    : learn_test.c
+//  Description  : Runs edge traces through the firmware's IR learning code
+//  Target       : Linux host
+//
+//  A trace is one Timer1 timestamp (0.5 us ticks) per line, as ICP1 would
+//  capture them, with '#' comment lines. "# mode raw" or "# mode demod"
+//  says how the receiver was sampled and "# expect" gives the Pronto code
+//  the signal should learn as. The edges are fed to learn.c the way
+//  learn_code() does, with learn_idle() polled in the gaps and the
+//  timestamps wrapped to 16 bits. The preamble must match exactly and
+//  every burst word to within an eighth plus two carrier periods, which
+//  leaves room for the receiver's own mark/space distortion.
+//
+//  Usage: learn_test trace...
+//  Exits non-zero if any trace fails.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "learn.h"
+
+#define MAX_WORDS    256
+#define POLL_TICKS   2000        // learn_idle() every 1 ms between edges
+#define PREAMBLE     4           // Format, carrier, once and repeat counts
+
+static int parse_words(const char *s,unsigned *w,int max)
+{
+  int n = 0,used;
+
+  while (n < max && sscanf(s,"%x%n",&w[n],&used) == 1) {
+    s += used;
+    n++;
+  }
+  return n;
+}
+
+static int run(const char *path)
+{
+  FILE *f = fopen(path,"r");
+  char line[2048];
+  uint16_t dur[LEARN_MAX];
+  uint8_t out[2 * MAX_WORDS];
+  unsigned expect[MAX_WORDS];
+  learn_t l;
+  long stamp,now = 0;
+  int raw = 0,nexp = 0,edges = 0,len,i,bad = 0;
+  unsigned got,want,slack;
+
+  if (f == NULL) {
+    perror(path);
+    return 1;
+  }
+  // Mode and expected code come first, then the edges
+  while (fgets(line,sizeof(line),f) != NULL && line[0] == '#') {
+    if (strncmp(line,"# mode raw",10) == 0)
+      raw = 1;
+    else if (strncmp(line,"# expect ",9) == 0)
+      nexp = parse_words(line + 9,expect,MAX_WORDS);
+  }
+  learn_init(&l,dur,LEARN_MAX,raw);
+  do {
+    if (line[0] == '#' || sscanf(line,"%ld",&stamp) != 1) continue;
+    // Poll through the gap as the main loop would
+    while (edges > 0 && stamp - now > POLL_TICKS) {
+      now += POLL_TICKS;
+      learn_idle(&l,(uint16_t)now);
+    }
+    learn_edge(&l,(uint16_t)stamp);
+    now = stamp;
+    edges++;
+  } while (fgets(line,sizeof(line),f) != NULL);
+  fclose(f);
+  // Silence after the last edge ends the capture
+  while (!learn_done(&l) && now < stamp + 4 * (long)LEARN_END_TICKS) {
+    now += POLL_TICKS;
+    learn_idle(&l,(uint16_t)now);
+  }
+
+  len = learn_pronto(&l,out,sizeof(out)) / 2;
+  if (len != nexp) {
+    printf("FAIL %s: %d edges learned as %d words, expected %d\n",path,edges,len,nexp);
+    bad = 1;
+  }
+  for (i = 0; i < len && i < nexp; i++) {
+    got = (out[2 * i] << 8) | out[2 * i + 1];
+    want = expect[i];
+    slack = (i < PREAMBLE) ? 0 : want / 8 + 2;
+    if (got + slack < want || got > want + slack) {
+      printf("FAIL %s: word %d is %04X, expected %04X\n",path,i,got,want);
+      bad = 1;
+    }
+  }
+  if (!bad)
+    printf("ok   %s: %d edges, %d words, carrier word %04X\n",path,edges,len,learn_freq(&l));
+  return bad;
+}
+
+int main(int argc,char **argv)
+{
+  int i,fails = 0;
+
+  if (argc < 2) {
+    fprintf(stderr,"usage: %s trace...\n",argv[0]);
+    return 1;
+  }
+  for (i = 1; i < argc; i++)
+    fails += run(argv[i]);
+  return fails != 0;
+}
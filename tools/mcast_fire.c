@@ -0,0 +1,151 @@
+/*****************************************************************************
+//  File Name    : mcast_fire.c
+//  Description  : Send an OpenRemote multicast command and time the acks
+//  Target       : Linux host
+//
+//  Every device that acts on the command reports how long it held it, from
+//  arrival to sending the ack: the jitter delay plus decoding and queueing
+//  the code. The round trip less that is the time on the network, and
+//  half of it is taken as when each device received the datagram; the
+//  first edge follows by the device's own arrival to edge figure. The
+//  spread of those times across the fleet is the fan-out latency spread.
+//
+//  Usage: mcast_fire [-g group] [-p port] [-t target] [-m mask]
+//                    [-w wait_ms] [-n rounds] [code]
+//  With no code the devices send their stored code.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define MC_HDR      8
+#define MC_ACK      0x01
+#define MC_REPLY    0x80
+#define MC_ACK_LEN  16
+#define MAX_DEV     256
+
+static double now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+int main(int argc,char **argv)
+{
+  const char *group = "239.255.42.1";
+  const char *code = "";
+  int port = 4210,target = 0xFFFF,mask = 0xFF,wait = 200,rounds = 1;
+  uint8_t pkt[1500],ack[64];
+  struct sockaddr_in to,from;
+  socklen_t fromlen;
+  struct pollfd pfd;
+  double sent,arrive[MAX_DEV],edge[MAX_DEV],left,rtt,hold;
+  int sock,opt,r,len,n,i,seen;
+  uint16_t seq;
+
+  while ((opt = getopt(argc,argv,"g:p:t:m:w:n:")) != -1) {
+    switch (opt) {
+      case 'g': group = optarg; break;
+      case 'p': port = atoi(optarg); break;
+      case 't': target = strtol(optarg,NULL,0); break;
+      case 'm': mask = strtol(optarg,NULL,0); break;
+      case 'w': wait = atoi(optarg); break;
+      case 'n': rounds = atoi(optarg); break;
+      default:
+        fprintf(stderr,"usage: %s [-g group] [-p port] [-t target] [-m mask] [-w wait_ms] [-n rounds] [code]\n",argv[0]);
+        return 1;
+    }
+  }
+  if (optind < argc)
+    code = argv[optind];
+  len = strlen(code);
+  if (MC_HDR + len > (int)sizeof(pkt)) {
+    fprintf(stderr,"code too long\n");
+    return 1;
+  }
+
+  sock = socket(AF_INET,SOCK_DGRAM,0);
+  if (sock < 0) {
+    perror("socket");
+    return 1;
+  }
+  opt = 1;
+  setsockopt(sock,IPPROTO_IP,IP_MULTICAST_TTL,&opt,sizeof(opt));
+  memset(&to,0,sizeof(to));
+  to.sin_family = AF_INET;
+  to.sin_port = htons(port);
+  if (inet_pton(AF_INET,group,&to.sin_addr) != 1) {
+    fprintf(stderr,"bad group %s\n",group);
+    return 1;
+  }
+
+  srand(time(NULL));
+  seq = rand();
+  for (r = 0; r < rounds; r++, seq++) {
+    pkt[0] = 'O';
+    pkt[1] = 'R';
+    pkt[2] = MC_ACK;
+    pkt[3] = mask;
+    pkt[4] = target >> 8;
+    pkt[5] = target & 0xFF;
+    pkt[6] = seq >> 8;
+    pkt[7] = seq & 0xFF;
+    memcpy(pkt + MC_HDR,code,len);
+
+    sent = now_ms();
+    if (sendto(sock,pkt,MC_HDR + len,0,(struct sockaddr *)&to,sizeof(to)) < 0) {
+      perror("sendto");
+      return 1;
+    }
+
+    seen = 0;
+    while ((left = sent + wait - now_ms()) > 0) {
+      pfd.fd = sock;
+      pfd.events = POLLIN;
+      if (poll(&pfd,1,(int)left + 1) <= 0) continue;
+      fromlen = sizeof(from);
+      n = recvfrom(sock,ack,sizeof(ack),0,(struct sockaddr *)&from,&fromlen);
+      if (n < MC_ACK_LEN || ack[0] != 'O' || ack[1] != 'R' || !(ack[2] & MC_REPLY)) continue;
+      if (((ack[6] << 8) | ack[7]) != seq || seen == MAX_DEV) continue;
+
+      // Round trip less the time the device held the command
+      rtt = now_ms() - sent;
+      hold = get32(ack + 8) / 1000.0;
+      arrive[seen] = (rtt - hold) / 2;
+      edge[seen] = arrive[seen] + get32(ack + 12) / 1000.0;
+      printf("round %d device %04x %-15s recv %7.2f ms  first edge %7.2f ms  held %7.2f ms\n",
+             r,(ack[4] << 8) | ack[5],inet_ntoa(from.sin_addr),arrive[seen],edge[seen],hold);
+      seen++;
+    }
+
+    if (seen > 0) {
+      double lo = arrive[0],hi = arrive[0],elo = edge[0],ehi = edge[0];
+      for (i = 1; i < seen; i++) {
+        if (arrive[i] < lo) lo = arrive[i];
+        if (arrive[i] > hi) hi = arrive[i];
+        if (edge[i] < elo) elo = edge[i];
+        if (edge[i] > ehi) ehi = edge[i];
+      }
+      printf("round %d: %d devices, recv min %.2f ms, max %.2f ms, spread %.2f ms; first edge spread %.2f ms\n",
+             r,seen,lo,hi,hi - lo,ehi - elo);
+    } else {
+      printf("round %d: no acks\n",r);
+    }
+  }
+  close(sock);
+  return 0;
+}
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Turn the files under a web root into PROGMEM blobs for the web server.
+
+Usage: mkassets.py <www dir> <output base>
+
+Writes <output base>.c and <output base>.h. Every file is stored both as
+is and gzip compressed, with an ETag taken from a hash of its contents.
+index.html is also served as "/". Output is deterministic, so the
+generated files only change when the assets do.
+"""
+import gzip
+import hashlib
+import os
+import sys
+
+TYPES = {
+    '.html': 'text/html',
+    '.css': 'text/css',
+    '.js': 'application/javascript',
+    '.ico': 'image/x-icon',
+    '.png': 'image/png',
+    '.txt': 'text/plain',
+}
+
+# Files that never change between firmware builds can be cached outright;
+# everything else is revalidated with If-None-Match
+LONG_CACHE = ('.ico', '.png')
+
+
+def c_name(path):
+    return ''.join(c if c.isalnum() else '_' for c in path)
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append('  ' + ','.join('0x%02x' % b for b in data[i:i + 16]) + ',')
+    return '\n'.join(lines)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    root, base = sys.argv[1], sys.argv[2]
+    header = os.path.basename(base) + '.h'
+
+    assets = []
+    for name in sorted(os.listdir(root)):
+        full = os.path.join(root, name)
+        ext = os.path.splitext(name)[1]
+        if not os.path.isfile(full) or ext not in TYPES:
+            continue
+        raw = open(full, 'rb').read()
+        gz = gzip.compress(raw, 9, mtime=0)
+        etag = hashlib.sha1(raw).hexdigest()[:8]
+        path = '/' if name == 'index.html' else '/' + name
+        assets.append((path, c_name(name), TYPES[ext], etag, raw, gz,
+                       ext in LONG_CACHE))
+
+    with open(base + '.h', 'w') as h:
+        h.write('''/*****************************************************************************
+//  File Name    : %s
+//  Description  : Static web assets, generated by tools/mkassets.py
+//                 from %s/ - do not edit
+*****************************************************************************/
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#define ASSET_LONG_CACHE 0x01      // Cache without revalidating
+
+typedef struct {
+  PGM_P path;                  // Request path
+  PGM_P type;                  // Content-Type
+  PGM_P etag;                  // ETag of the file, "-gz" is added for the gzip copy
+  const uint8_t *raw;          // File as is
+  uint16_t raw_len;
+  const uint8_t *gz;           // File gzip compressed
+  uint16_t gz_len;
+  uint8_t flags;
+} asset_t;
+
+#define ASSET_COUNT %d
+extern const asset_t assets[ASSET_COUNT] PROGMEM;
+
+#endif
+''' % (header, os.path.basename(os.path.normpath(root)), len(assets)))
+
+    with open(base + '.c', 'w') as c:
+        c.write('''/*****************************************************************************
+//  File Name    : %s.c
+//  Description  : Static web assets, generated by tools/mkassets.py
+//                 from %s/ - do not edit
+*****************************************************************************/
+#include "%s"
+''' % (os.path.basename(base), os.path.basename(os.path.normpath(root)), header))
+        for path, name, ctype, etag, raw, gz, long_cache in assets:
+            c.write('''
+// %s: %d bytes, %d gzipped
+static const char %s_path[] PROGMEM = "%s";
+static const char %s_type[] PROGMEM = "%s";
+static const char %s_etag[] PROGMEM = "%s";
+static const uint8_t %s_raw[] PROGMEM = {
+%s
+};
+static const uint8_t %s_gz[] PROGMEM = {
+%s
+};
+''' % (path, len(raw), len(gz), name, path, name, ctype, name, etag,
+                name, c_bytes(raw), name, c_bytes(gz)))
+        c.write('\nconst asset_t assets[ASSET_COUNT] PROGMEM = {\n')
+        for path, name, ctype, etag, raw, gz, long_cache in assets:
+            c.write('  {%s_path,%s_type,%s_etag,%s_raw,%d,%s_gz,%d,%s},\n' % (
+                name, name, name, name, len(raw), name, len(gz),
+                'ASSET_LONG_CACHE' if long_cache else '0'))
+        c.write('};\n')
+
+
+if __name__ == '__main__':
+    main()
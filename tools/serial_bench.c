@@ -0,0 +1,299 @@
+/*****************************************************************************
+//  File Name    : serial_bench.c
+//  Description  : Throughput and latency benchmark for the serial control
+//                 channel
+//  Target       : Linux host
+//
+//  Sends PING, UPLOAD, FIRE and STATS frames and times the replies; the
+//  uploads are whole, valid Pronto codes, as a real board would get. With
+//  -l the device end is a child process on a pty running the same framer
+//  as the firmware, so the host side and the framing can be measured
+//  without hardware.
+//
+//  Usage: serial_bench [-d device] [-b baud] [-n count] [-l]
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/wait.h>
+#include "frame.h"
+
+#define TIMEOUT_MS 200
+
+// The upload test sends a valid code: raw, 38 kHz, with BENCH_PAIRS
+// burst pairs of BENCH_BURST carrier periods each, about 13 ms on air.
+// 4 + 2 * 61 words is 252 bytes, exactly four full upload frames.
+#define BENCH_PAIRS 61
+#define BENCH_BURST 0x0004
+#define BENCH_CHUNK (FRAME_MAX - 1)
+
+static double now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static speed_t baud_flag(long baud)
+{
+  switch (baud) {
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 500000: return B500000;
+    case 1000000: return B1000000;
+  }
+  fprintf(stderr,"unsupported baud %ld\n",baud);
+  exit(1);
+}
+
+static void set_raw(int fd,long baud)
+{
+  struct termios t;
+
+  if (tcgetattr(fd,&t) < 0) return;
+  cfmakeraw(&t);
+  if (baud) {
+    cfsetispeed(&t,baud_flag(baud));
+    cfsetospeed(&t,baud_flag(baud));
+  }
+  tcsetattr(fd,TCSANOW,&t);
+}
+
+static void send_frame(int fd,uint8_t cmd,const uint8_t *payload,uint8_t len)
+{
+  uint8_t out[FRAME_MAX + FRAME_OVERHEAD];
+  int n = frame_build(out,cmd,payload,len);
+
+  if (write(fd,out,n) != n) {
+    perror("write");
+    exit(1);
+  }
+}
+
+// Wait for the next valid frame; returns 0 on timeout
+static int read_frame(int fd,frame_rx_t *f,int timeout_ms)
+{
+  struct pollfd pfd;
+  uint8_t buf[256];
+  static uint8_t pending[256];
+  static int pend_len,pend_pos;
+  double end = now_ms() + timeout_ms;
+  int n;
+
+  for (;;) {
+    while (pend_pos < pend_len) {
+      if (frame_rx(f,pending[pend_pos++])) return 1;
+    }
+    if (now_ms() >= end) return 0;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd,1,(int)(end - now_ms()) + 1) <= 0) continue;
+    n = read(fd,buf,sizeof(buf));
+    if (n <= 0) return 0;
+    memcpy(pending,buf,n);
+    pend_len = n;
+    pend_pos = 0;
+  }
+}
+
+// Stand in for the firmware on the slave side of a pty
+static void device(int fd)
+{
+  frame_rx_t f;
+  uint8_t reply[15];
+  uint32_t code_len = 0;
+
+  frame_init(&f);
+  for (;;) {
+    if (!read_frame(fd,&f,1000)) continue;
+    memset(reply,0,sizeof(reply));
+    switch (f.cmd) {
+      case CMD_PING:
+        send_frame(fd,CMD_PING | FRAME_REPLY,f.payload,f.len);
+        continue;
+      case CMD_UPLOAD:
+        if (f.len && (f.payload[0] & UPLOAD_FIRST))
+          code_len = 0;
+        code_len += f.len ? f.len - 1 : 0;
+        break;
+      case CMD_FIRE:
+        if (code_len == 0) reply[0] = STATUS_NO_CODE;
+        break;
+      case CMD_STATS:
+        reply[1] = code_len >> 8;
+        reply[2] = code_len & 0xFF;
+        reply[11] = f.errors >> 8;
+        reply[12] = f.errors & 0xFF;
+        send_frame(fd,CMD_STATS | FRAME_REPLY,reply,15);
+        continue;
+      default:
+        reply[0] = STATUS_BAD;
+    }
+    send_frame(fd,f.cmd | FRAME_REPLY,reply,1);
+  }
+}
+
+// Build the upload test code as big endian words; returns its length
+static int bench_code(uint8_t *code)
+{
+  int i,n = 0;
+  uint16_t w;
+
+  for (i = 0; i < 4 + 2 * BENCH_PAIRS; i++) {
+    switch (i) {
+      case 1: w = 0x006D; break;           // 38 kHz
+      case 3: w = BENCH_PAIRS; break;      // Once sequence only
+      case 0:
+      case 2: w = 0; break;
+      default: w = BENCH_BURST; break;
+    }
+    code[n++] = w >> 8;
+    code[n++] = w & 0xFF;
+  }
+  return n;
+}
+
+// Send one frame and wait for its reply; returns the round trip in ms
+static double transact(int fd,frame_rx_t *f,uint8_t cmd,const uint8_t *payload,uint8_t len)
+{
+  double start = now_ms();
+
+  send_frame(fd,cmd,payload,len);
+  while (read_frame(fd,f,TIMEOUT_MS)) {
+    if (f->cmd == (cmd | FRAME_REPLY))
+      return now_ms() - start;
+  }
+  return -1;
+}
+
+static void report(const char *name,double *t,int n,int bytes)
+{
+  double sum = 0,lo = 1e9,hi = 0;
+  int i,ok = 0;
+
+  for (i = 0; i < n; i++) {
+    if (t[i] < 0) continue;
+    sum += t[i];
+    if (t[i] < lo) lo = t[i];
+    if (t[i] > hi) hi = t[i];
+    ok++;
+  }
+  if (ok == 0) {
+    printf("%-7s no replies\n",name);
+    return;
+  }
+  printf("%-7s %4d/%d ok  avg %.3f ms  min %.3f ms  max %.3f ms",name,ok,n,sum / ok,lo,hi);
+  if (bytes)
+    printf("  %.1f KB/s",bytes * ok / sum);
+  printf("\n");
+}
+
+int main(int argc,char **argv)
+{
+  const char *dev = NULL;
+  long baud = 1000000;
+  int count = 200,loop = 0,fd,slave,opt,i,len,off,n,busy,frames;
+  uint8_t payload[FRAME_MAX],code[2 * (4 + 2 * BENCH_PAIRS)];
+  double *t;
+  frame_rx_t f;
+  pid_t child = 0;
+
+  while ((opt = getopt(argc,argv,"d:b:n:l")) != -1) {
+    switch (opt) {
+      case 'd': dev = optarg; break;
+      case 'b': baud = atol(optarg); break;
+      case 'n': count = atoi(optarg); break;
+      case 'l': loop = 1; break;
+      default:
+        fprintf(stderr,"usage: %s [-d device] [-b baud] [-n count] [-l]\n",argv[0]);
+        return 1;
+    }
+  }
+  if (!loop && dev == NULL) {
+    fprintf(stderr,"need -d device or -l\n");
+    return 1;
+  }
+
+  if (loop) {
+    if (openpty(&fd,&slave,NULL,NULL,NULL) < 0) {
+      perror("openpty");
+      return 1;
+    }
+    set_raw(fd,0);
+    set_raw(slave,0);
+    child = fork();
+    if (child == 0) {
+      close(fd);
+      device(slave);
+      _exit(0);
+    }
+    close(slave);
+  } else {
+    fd = open(dev,O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+      perror(dev);
+      return 1;
+    }
+    set_raw(fd,baud);
+  }
+
+  t = calloc(count,sizeof(double));
+  frame_init(&f);
+  // PING echoes arbitrary bytes
+  for (i = 0; i < FRAME_MAX; i++)
+    payload[i] = i;
+
+  for (i = 0; i < count; i++)
+    t[i] = transact(fd,&f,CMD_PING,payload,8);
+  report("ping",t,count,0);
+
+  // Whole codes in full frames. A code is still on air when the next
+  // one starts, so a BUSY reply to its first frame is retried and only
+  // the accepted round trip counts.
+  len = bench_code(code);
+  frames = 0;
+  for (i = 0; i + len / BENCH_CHUNK <= count; ) {
+    for (off = 0; off < len; off += n, i++) {
+      n = (len - off > BENCH_CHUNK) ? BENCH_CHUNK : len - off;
+      payload[0] = (off == 0 ? UPLOAD_FIRST : 0) | (off + n == len ? UPLOAD_LAST : 0);
+      memcpy(payload + 1,code + off,n);
+      do {
+        t[i] = transact(fd,&f,CMD_UPLOAD,payload,n + 1);
+        busy = t[i] >= 0 && f.len > 0 && f.payload[0] == STATUS_BUSY;
+        if (busy)
+          usleep(1000);
+      } while (busy);
+    }
+    frames = i;
+  }
+  report("upload",t,frames,FRAME_MAX + FRAME_OVERHEAD);
+
+  for (i = 0; i < count; i++)
+    t[i] = transact(fd,&f,CMD_FIRE,NULL,0);
+  report("fire",t,count,0);
+
+  if (transact(fd,&f,CMD_STATS,NULL,0) >= 0 && f.len >= 15) {
+    printf("stats: code %u bytes, arena peak %u, first edge %u us, underruns %u, crc errors %u, overruns %u\n",
+           (f.payload[1] << 8) | f.payload[2],(f.payload[3] << 8) | f.payload[4],
+           (unsigned)((f.payload[5] << 24) | (f.payload[6] << 16) | (f.payload[7] << 8) | f.payload[8]),
+           (f.payload[9] << 8) | f.payload[10],(f.payload[11] << 8) | f.payload[12],
+           (f.payload[13] << 8) | f.payload[14]);
+  }
+
+  if (child > 0) {
+    kill(child,SIGTERM);
+    waitpid(child,NULL,0);
+  }
+  free(t);
+  close(fd);
+  return 0;
+}
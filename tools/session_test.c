@@ -0,0 +1,203 @@
+/*****************************************************************************
+//  File Name    : session_test.c
+//  Description  : Runs the gateway session loop against a simulated W5100
+//  Target       : Linux host
+//
+//  session.c, frame.c and w5100.c are the firmware's own; the chip is the
+//  one in w5100_sim.c and frame_command() is a stand in that echoes PINGs
+//  and keeps the UPLOAD words. A gateway's batch of frames is pushed onto
+//  the session socket, whole or a few bytes per poll, and every reply has
+//  to come back intact and in order.
+//
+//  Usage: session_test
+//  Exits non-zero if any check fails.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "w5100_sim.h"
+#include "session.h"
+#include "arena.h"
+
+#define GUARD            16
+#define GUARD_BYTE       0xA5
+#define CODE_LEN         300      // Bytes of Pronto words, five UPLOAD frames
+#define BATCH_MAX        1024     // Socket 3's Rx buffer
+
+static int fails;
+
+static void check(int ok,const char *what)
+{
+  printf("%s %s\n",ok ? "ok  " : "FAIL",what);
+  if (!ok) fails++;
+}
+
+// The arena, as exact sized allocations with guard bytes after them
+static int alloc_len,alloc_bad,guard_hit;
+
+uint8_t *arena_alloc(uint8_t owner,uint16_t len)
+{
+  uint8_t *p = malloc(sizeof(uint16_t) + len + GUARD);
+
+  if (owner != ARENA_SCRATCH || len != SESSION_SCRATCH) alloc_bad++;
+  memcpy(p,&len,sizeof(len));
+  memset(p + sizeof(len) + len,GUARD_BYTE,GUARD);
+  alloc_len = len;
+  return p + sizeof(len);
+}
+
+void arena_free(uint8_t *ptr)
+{
+  uint8_t *p = ptr - sizeof(uint16_t);
+  uint16_t len,i;
+
+  memcpy(&len,p,sizeof(len));
+  for (i = 0; i < GUARD; i++) {
+    if (ptr[len + i] != GUARD_BYTE) guard_hit++;
+  }
+  free(p);
+}
+
+// The application side: PING echoes, UPLOAD appends its words
+static uint8_t code[CODE_LEN],code_sent[CODE_LEN];
+static int code_len;
+
+uint8_t frame_command(frame_rx_t *f)
+{
+  switch (f->cmd) {
+    case CMD_PING:
+      return f->len;
+    case CMD_UPLOAD:
+      if (f->len < 1) break;
+      if (f->payload[0] & UPLOAD_FIRST) code_len = 0;
+      if (code_len + f->len - 1 > CODE_LEN) break;
+      memcpy(code + code_len,f->payload + 1,f->len - 1);
+      code_len += f->len - 1;
+      f->payload[0] = STATUS_OK;
+      return 1;
+  }
+  f->payload[0] = STATUS_BAD;
+  return 1;
+}
+
+// A gateway's batch and the replies it expects
+static uint8_t batch[BATCH_MAX],expect[BATCH_MAX];
+static uint16_t batch_len,expect_len;
+static int batch_frames;
+
+static void batch_add(uint8_t cmd,const uint8_t *payload,uint8_t len,const uint8_t *reply,uint8_t reply_len)
+{
+  batch_len += frame_build(batch + batch_len,cmd,payload,len);
+  expect_len += frame_build(expect + expect_len,cmd | FRAME_REPLY,reply,reply_len);
+  batch_frames++;
+}
+
+// An upload of the whole test code, with pings of every size between
+static void batch_fill(void)
+{
+  uint8_t p[FRAME_MAX];
+  const uint8_t ok = STATUS_OK;
+  int pos,n,len,i;
+
+  batch_len = expect_len = 0;
+  batch_frames = 0;
+  for (pos = 0; pos < CODE_LEN; pos += n) {
+    n = (CODE_LEN - pos > FRAME_MAX - 1) ? FRAME_MAX - 1 : CODE_LEN - pos;
+    p[0] = (pos == 0) ? UPLOAD_FIRST : 0;
+    if (pos + n == CODE_LEN) p[0] |= UPLOAD_LAST;
+    memcpy(p + 1,code_sent + pos,n);
+    batch_add(CMD_UPLOAD,p,n + 1,&ok,1);
+    // FRAME_SOF inside the payload must not upset anything
+    len = (pos * 7) % (FRAME_MAX + 1);
+    for (i = 0; i < len; i++)
+      p[i] = (i & 1) ? FRAME_SOF : pos + i;
+    batch_add(CMD_PING,p,len,p,len);
+  }
+  for (i = 0; i < 8; i++)
+    batch_add(CMD_PING,NULL,0,NULL,0);
+}
+
+// Replies the session sent, as the gateway sees them
+static int replies_check(const char *how)
+{
+  static uint8_t got[SIM_SINK_MAX];
+  frame_rx_t rx;
+  uint16_t n,i;
+  int frames = 0;
+  char what[96];
+
+  n = sim_tx_take(SESSION_SOCK,got,sizeof(got));
+  frame_init(&rx);
+  for (i = 0; i < n; i++)
+    frames += frame_rx(&rx,got[i]);
+  snprintf(what,sizeof(what),"%s: %d replies for %d frames, %u bad",how,frames,batch_frames,rx.errors);
+  check(frames == batch_frames && rx.errors == 0,what);
+  snprintf(what,sizeof(what),"%s: replies match byte for byte",how);
+  check(n == expect_len && memcmp(got,expect,n) == 0,what);
+  snprintf(what,sizeof(what),"%s: upload reassembled",how);
+  check(code_len == CODE_LEN && memcmp(code,code_sent,CODE_LEN) == 0,what);
+  return frames;
+}
+
+static void session_open(void)
+{
+  sim_reset();
+  session_init();
+  session_poll();
+  check(sim_mem[SOCK_BASE(SESSION_SOCK) + Sn_SR] == SOCK_LISTEN,"a closed session socket is opened and listens");
+  // The gateway connects
+  sim_mem[SOCK_BASE(SESSION_SOCK) + Sn_SR] = SOCK_ESTABLISHED;
+}
+
+// The whole batch waiting at once, handled in one poll
+static void test_batch(void)
+{
+  int round;
+
+  session_open();
+  for (round = 0; round < 3; round++) {
+    code_len = 0;
+    sim_rx_push(SESSION_SOCK,batch,batch_len);
+    session_poll();
+    check(w5100_recv_size(SESSION_SOCK) == 0,"one poll reads everything queued");
+    replies_check("whole batch");
+  }
+}
+
+// The batch trickling in, frames split across polls and chunk reads
+static void test_trickle(void)
+{
+  static const uint16_t steps[] = {1,7,31,33,64,97};
+  uint16_t pos,n;
+  unsigned s;
+  char how[32];
+
+  for (s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+    session_open();
+    code_len = 0;
+    for (pos = 0; pos < batch_len; pos += n) {
+      n = (batch_len - pos > steps[s]) ? steps[s] : batch_len - pos;
+      sim_rx_push(SESSION_SOCK,batch + pos,n);
+      session_poll();
+    }
+    snprintf(how,sizeof(how),"%u bytes a poll",steps[s]);
+    replies_check(how);
+  }
+}
+
+int main(void)
+{
+  int i;
+
+  for (i = 0; i < CODE_LEN; i++)
+    code_sent[i] = (i * 37) ^ (i >> 3);
+  batch_fill();
+  test_batch();
+  test_trickle();
+  check(alloc_len == SESSION_SCRATCH && alloc_bad == 0,"session takes SESSION_SCRATCH bytes of scratch");
+  check(guard_hit == 0,"session stays inside its scratch");
+  check(sim_bad_frames == 0,"session uses only whole 4 byte SPI frames");
+  if (fails)
+    printf("%d checks failed\n",fails);
+  return fails != 0;
+}
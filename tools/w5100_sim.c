@@ -0,0 +1,176 @@
+/*****************************************************************************
+//  File Name    : w5100_sim.c
+//  Description  : Simulated W5100 behind the driver's W5100_HOST hooks
+//  Target       : Linux host
+//
+//  Supplies w5100_host_select() / w5100_host_xfer() for w5100.c built with
+//  W5100_HOST. Every chip select must frame exactly one 4 byte opcode,
+//  address, data transfer; each one is logged. The register file and the
+//  socket memory are kept, the MR reset bit clears itself and socket
+//  commands take effect at once, as far as the firmware can tell:
+//  CR_OPEN, CR_LISTEN and CR_CLOSE move Sn_SR, CR_RECV frees what was
+//  read and CR_SEND moves what was written to a sink the test can take.
+*****************************************************************************/
+#include <string.h>
+#include "w5100_sim.h"
+
+uint8_t sim_mem[SIM_MEM_SIZE];
+sim_frame_t sim_frames[SIM_LOG_MAX];
+int sim_nframes;
+int sim_bad_frames;
+uint16_t sim_stuck_addr;
+uint8_t sim_stuck_bits;
+uint8_t sim_open_fails;
+
+static const uint16_t rx_base[SOCK_MAX] = {RX_BUF_BASE(0),RX_BUF_BASE(1),RX_BUF_BASE(2),RX_BUF_BASE(3)};
+static const uint16_t rx_mask[SOCK_MAX] = {RX_BUF_MASK(0),RX_BUF_MASK(1),RX_BUF_MASK(2),RX_BUF_MASK(3)};
+static const uint16_t tx_base[SOCK_MAX] = {TX_BUF_BASE(0),TX_BUF_BASE(1),TX_BUF_BASE(2),TX_BUF_BASE(3)};
+static const uint16_t tx_mask[SOCK_MAX] = {TX_BUF_MASK(0),TX_BUF_MASK(1),TX_BUF_MASK(2),TX_BUF_MASK(3)};
+
+static uint8_t cur[4];
+static int cur_len;
+static int selected;
+static uint16_t rx_wr[SOCK_MAX];        // The chip's own Rx write pointer
+static uint8_t sink[SOCK_MAX][SIM_SINK_MAX];
+static uint16_t sink_len[SOCK_MAX];
+
+void sim_set16(uint16_t addr,uint16_t v)
+{
+  sim_mem[addr] = v >> 8;
+  sim_mem[addr + 1] = v & 0xFF;
+}
+
+uint16_t sim_get16(uint16_t addr)
+{
+  return (sim_mem[addr] << 8) | sim_mem[addr + 1];
+}
+
+void sim_reset(void)
+{
+  uint8_t s;
+
+  memset(sim_mem,0,sizeof(sim_mem));
+  memset(rx_wr,0,sizeof(rx_wr));
+  memset(sink_len,0,sizeof(sink_len));
+  sim_nframes = 0;
+  sim_bad_frames = 0;
+  sim_stuck_addr = 0xFFFF;
+  sim_stuck_bits = 0;
+  sim_open_fails = 0;
+  for (s = 0; s < SOCK_MAX; s++)
+    sim_set16(SOCK_BASE(s) + Sn_TX_FSR,tx_mask[s] + 1);
+}
+
+void sim_rx_push(uint8_t sock,const uint8_t *data,uint16_t len)
+{
+  uint16_t base = SOCK_BASE(sock);
+
+  while (len--)
+    sim_mem[rx_base[sock] + (rx_wr[sock]++ & rx_mask[sock])] = *data++;
+  sim_set16(base + Sn_RX_RSR,rx_wr[sock] - sim_get16(base + Sn_RX_RD));
+}
+
+uint16_t sim_tx_take(uint8_t sock,uint8_t *data,uint16_t max)
+{
+  uint16_t n = (sink_len[sock] < max) ? sink_len[sock] : max;
+
+  memcpy(data,sink[sock],n);
+  memmove(sink[sock],sink[sock] + n,sink_len[sock] - n);
+  sink_len[sock] -= n;
+  return n;
+}
+
+static void sim_command(uint8_t sock,uint8_t cmd)
+{
+  uint16_t base = SOCK_BASE(sock);
+  uint8_t *sr = &sim_mem[base + Sn_SR];
+  uint16_t rd,wr;
+
+  switch (cmd) {
+    case CR_OPEN:
+      if (sim_open_fails)
+        *sr = SOCK_CLOSED;
+      else if ((sim_mem[base + Sn_MR] & 0x0F) == MR_TCP)
+        *sr = SOCK_INIT;
+      else if ((sim_mem[base + Sn_MR] & 0x0F) == MR_UDP)
+        *sr = SOCK_UDP;
+      break;
+    case CR_LISTEN:
+      if (*sr == SOCK_INIT)
+        *sr = SOCK_LISTEN;
+      break;
+    case CR_CLOSE:
+      *sr = SOCK_CLOSED;
+      break;
+    case CR_RECV:
+      sim_set16(base + Sn_RX_RSR,rx_wr[sock] - sim_get16(base + Sn_RX_RD));
+      break;
+    case CR_SEND:
+      rd = sim_get16(base + Sn_TX_RD);
+      wr = sim_get16(base + Sn_TX_WR);
+      for (; rd != wr; rd++) {
+        if (sink_len[sock] < SIM_SINK_MAX)
+          sink[sock][sink_len[sock]++] = sim_mem[tx_base[sock] + (rd & tx_mask[sock])];
+      }
+      sim_set16(base + Sn_TX_RD,rd);
+      break;
+  }
+}
+
+void w5100_host_select(uint8_t on)
+{
+  uint16_t addr;
+
+  if (on) {
+    if (selected) sim_bad_frames++;
+    selected = 1;
+    cur_len = 0;
+    return;
+  }
+  selected = 0;
+  addr = (cur[1] << 8) | cur[2];
+  if (cur_len != 4 || (cur[0] != WIZNET_WRITE_OPCODE && cur[0] != WIZNET_READ_OPCODE) ||
+      addr >= SIM_MEM_SIZE) {
+    sim_bad_frames++;
+    return;
+  }
+  if (sim_nframes < SIM_LOG_MAX) {
+    sim_frames[sim_nframes].op = cur[0];
+    sim_frames[sim_nframes].addr = addr;
+    sim_frames[sim_nframes].data = cur[3];
+  }
+  sim_nframes++;
+  if (cur[0] != WIZNET_WRITE_OPCODE) return;
+  if (addr == MR && (cur[3] & 0x80)) {
+    // Software reset: clears the common registers and itself
+    memset(sim_mem,0,0x30);
+    return;
+  }
+  if (addr >= SOCK_BASE(0) && addr < SOCK_BASE(SOCK_MAX) && (addr & 0xFF) == Sn_CR) {
+    sim_command((addr - SOCK_BASE(0)) >> 8,cur[3]);
+    return;
+  }
+  sim_mem[addr] = cur[3];
+}
+
+uint8_t w5100_host_xfer(uint8_t data)
+{
+  uint16_t addr;
+  uint8_t out = 0;
+
+  if (!selected || cur_len >= 4) {
+    sim_bad_frames++;
+    return 0;
+  }
+  if (cur_len == 3 && cur[0] == WIZNET_READ_OPCODE) {
+    addr = ((cur[1] << 8) | cur[2]) & (SIM_MEM_SIZE - 1);
+    out = sim_mem[addr];
+    if (addr == sim_stuck_addr)
+      out ^= sim_stuck_bits;
+  }
+  cur[cur_len++] = data;
+  // A read logs the byte the chip sent back
+  if (cur_len == 4 && cur[0] == WIZNET_READ_OPCODE)
+    cur[3] = out;
+  return out;
+}
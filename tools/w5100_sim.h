@@ -0,0 +1,38 @@
+/*****************************************************************************
+//  File Name    : w5100_sim.h
+//  Description  : Simulated W5100 behind the driver's W5100_HOST hooks
+//  Target       : Linux host
+*****************************************************************************/
+#ifndef W5100_SIM_H
+#define W5100_SIM_H
+
+#include <stdint.h>
+#include "w5100.h"
+
+#define SIM_MEM_SIZE     0x8000
+#define SIM_LOG_MAX      256
+#define SIM_SINK_MAX     4096
+
+// One 4 byte SPI transfer; for a read, data is what the chip sent back
+typedef struct {
+  uint8_t op;
+  uint16_t addr;
+  uint8_t data;
+} sim_frame_t;
+
+extern uint8_t sim_mem[SIM_MEM_SIZE];   // Registers and socket memory
+extern sim_frame_t sim_frames[SIM_LOG_MAX];
+extern int sim_nframes;                  // Transfers logged since sim_reset()
+extern int sim_bad_frames;               // Chip selects that were not one transfer
+extern uint16_t sim_stuck_addr;          // Register that reads back wrong
+extern uint8_t sim_stuck_bits;
+extern uint8_t sim_open_fails;           // CR_OPEN leaves the socket closed
+
+void sim_reset(void);
+void sim_set16(uint16_t addr,uint16_t v);
+uint16_t sim_get16(uint16_t addr);
+// Data arriving on a socket, and data it has sent
+void sim_rx_push(uint8_t sock,const uint8_t *data,uint16_t len);
+uint16_t sim_tx_take(uint8_t sock,uint8_t *data,uint16_t max);
+
+#endif
@@ -0,0 +1,149 @@
+/*****************************************************************************
+//  File Name    : w5100_test.c
+//  Description  : Runs the shared W5100 driver against a simulated chip
+//  Target       : Linux host
+//
+//  w5100.c is built with W5100_HOST against the simulated chip in
+//  w5100_sim.c, which logs every SPI transfer. The exact register traffic
+//  of w5100_init() and w5100_socket() is compared against what the
+//  datasheet asks for, and a register is given stuck bits to check that
+//  verify catches a bad read back.
+//
+//  Usage: w5100_test
+//  Exits non-zero if any check fails.
+*****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "w5100_sim.h"
+
+static int fails;
+
+static void check(int ok,const char *what)
+{
+  printf("%s %s\n",ok ? "ok  " : "FAIL",what);
+  if (!ok) fails++;
+}
+
+// Frame i is op at addr, with data unless data is negative
+static int frame_is(int i,uint8_t op,uint16_t addr,int data)
+{
+  if (i >= sim_nframes) return 0;
+  return sim_frames[i].op == op && sim_frames[i].addr == addr && (data < 0 || sim_frames[i].data == data);
+}
+
+static const w5100_net_t net = {
+  {192,168,2,1},
+  {255,255,255,0},
+  {0x00,0x16,0x36,0xDE,0x58,0xF6},
+  {192,168,2,10},
+};
+
+static void test_init(void)
+{
+  const uint8_t *bytes = (const uint8_t *)&net;
+  int i,f,ok;
+
+  sim_reset();
+  check(w5100_init(&net) == 1,"init programs and verifies");
+
+  // Reset, then poll MR until the reset bit clears
+  ok = frame_is(0,WIZNET_WRITE_OPCODE,MR,0x80) && frame_is(1,WIZNET_READ_OPCODE,MR,0x00);
+  f = 2;
+  // GAR..SIPR as one run, then RMSR and TMSR
+  for (i = 0; i < (int)sizeof(net); i++)
+    ok = ok && frame_is(f++,WIZNET_WRITE_OPCODE,GAR + i,bytes[i]);
+  ok = ok && frame_is(f++,WIZNET_WRITE_OPCODE,RMSR,W5100_RX_MEMSIZE);
+  ok = ok && frame_is(f++,WIZNET_WRITE_OPCODE,TMSR,W5100_TX_MEMSIZE);
+  check(ok,"init writes reset, GAR..SIPR, RMSR and TMSR in order");
+
+  // Then reads every one of them back
+  ok = 1;
+  for (i = 0; i < (int)sizeof(net); i++)
+    ok = ok && frame_is(f++,WIZNET_READ_OPCODE,GAR + i,bytes[i]);
+  ok = ok && frame_is(f++,WIZNET_READ_OPCODE,RMSR,W5100_RX_MEMSIZE);
+  ok = ok && frame_is(f++,WIZNET_READ_OPCODE,TMSR,W5100_TX_MEMSIZE);
+  check(ok && f == sim_nframes,"init reads back all 20 registers and nothing else");
+  check(sim_bad_frames == 0,"init sends only whole 4 byte frames");
+}
+
+static void test_verify(void)
+{
+  sim_reset();
+  sim_stuck_addr = SUBR + 3;
+  sim_stuck_bits = 0x01;
+  check(w5100_init(&net) == 0,"init fails when a network register reads back wrong");
+
+  sim_reset();
+  sim_stuck_addr = TMSR;
+  sim_stuck_bits = 0x40;
+  check(w5100_init(&net) == 0,"init fails when TMSR reads back wrong");
+}
+
+static void test_socket(void)
+{
+  uint16_t base = SOCK_BASE(1);
+  int ok;
+
+  sim_reset();
+  check(w5100_socket(1,MR_TCP,80) == 1,"socket opens a TCP socket");
+  // Status, mode, port high and low, open, wait for Sn_CR, status
+  ok = frame_is(0,WIZNET_READ_OPCODE,base + Sn_SR,SOCK_CLOSED) &&
+       frame_is(1,WIZNET_WRITE_OPCODE,base + Sn_MR,MR_TCP) &&
+       frame_is(2,WIZNET_WRITE_OPCODE,base + Sn_PORT,0) &&
+       frame_is(3,WIZNET_WRITE_OPCODE,base + Sn_PORT + 1,80) &&
+       frame_is(4,WIZNET_WRITE_OPCODE,base + Sn_CR,CR_OPEN) &&
+       frame_is(5,WIZNET_READ_OPCODE,base + Sn_CR,0) &&
+       frame_is(6,WIZNET_READ_OPCODE,base + Sn_SR,SOCK_INIT) &&
+       sim_nframes == 7;
+  check(ok,"socket frames: status, Sn_MR, Sn_PORT, CR_OPEN, status");
+  check(w5100_listen(1) == 1 && sim_mem[base + Sn_SR] == SOCK_LISTEN,"listen moves the socket to LISTEN");
+
+  // An open socket is closed before it is set up again
+  sim_nframes = 0;
+  check(w5100_socket(1,MR_UDP,4210) == 1 && sim_mem[base + Sn_SR] == SOCK_UDP,"socket reopens as UDP");
+  check(frame_is(1,WIZNET_WRITE_OPCODE,base + Sn_CR,CR_CLOSE),"socket closes the old socket first");
+
+  sim_reset();
+  sim_open_fails = 1;
+  check(w5100_socket(2,MR_TCP,80) == 0,"socket fails when the chip does not open it");
+  check(frame_is(sim_nframes - 2,WIZNET_WRITE_OPCODE,SOCK_BASE(2) + Sn_CR,CR_CLOSE),"a failed socket is closed");
+  check(sim_bad_frames == 0,"socket sends only whole 4 byte frames");
+}
+
+// Reads and writes wrap inside the socket's own buffer
+static void test_buffers(void)
+{
+  uint16_t base = SOCK_BASE(1);
+  uint16_t rx = RXBUFADDR + 0x0800,tx = TXBUFADDR + 0x0800;   // Socket 1, after socket 0's 2K
+  uint8_t buf[5];
+  const uint8_t out[4] = {'a','b','c','d'};
+
+  sim_reset();
+  sim_mem[base + Sn_RX_RD] = 0x07;
+  sim_mem[base + Sn_RX_RD + 1] = 0xFE;
+  sim_mem[rx + 0x7FE] = 'w';
+  sim_mem[rx + 0x7FF] = 'x';
+  sim_mem[rx] = 'y';
+  sim_mem[rx + 1] = 'z';
+  w5100_recv(1,buf,4);
+  check(memcmp(buf,"wxyz",5) == 0,"recv wraps at the end of the socket's Rx buffer");
+  check(sim_mem[base + Sn_RX_RD] == 0x08 && sim_mem[base + Sn_RX_RD + 1] == 0x02,"recv advances Sn_RX_RD");
+
+  sim_mem[base + Sn_TX_FSR] = 0x08;
+  sim_mem[base + Sn_TX_WR] = 0x0F;
+  sim_mem[base + Sn_TX_WR + 1] = 0xFF;
+  check(w5100_send(1,out,4) == 1,"send succeeds with room in the Tx buffer");
+  check(sim_mem[tx + 0x7FF] == 'a' && sim_mem[tx] == 'b' && sim_mem[tx + 2] == 'd',"send wraps at the end of the socket's Tx buffer");
+  check(sim_bad_frames == 0,"buffers are accessed with whole 4 byte frames");
+}
+
+int main(void)
+{
+  test_init();
+  test_verify();
+  test_socket();
+  test_buffers();
+  if (fails)
+    printf("%d checks failed\n",fails);
+  return fails != 0;
+}
@@ -0,0 +1,301 @@
+/*****************************************************************************
+//  File Name    : w5100.c
+//  Description  : Wiznet W5100 driver shared by the OpenRemote firmware
+//  Target       : AVRJazz Mega328 Board
+//
+//  Every W5100 access is one 4 byte SPI frame (opcode, address, data);
+//  the chip has no burst mode, so blocks are written as back to back
+//  frames with the address worked out once per byte in a register.
+//
+//  Building with W5100_HOST replaces the AVR SPI peripheral with
+//  w5100_host_select() / w5100_host_xfer(), supplied by a host simulator;
+//  tools/w5100_test is one.
+*****************************************************************************/
+#include <stddef.h>
+#include "w5100.h"
+
+// The socket buffers must fit the W5100's 8K of Tx and Rx memory
+typedef char w5100_rx_check[(W5100_BUF_TOTAL(W5100_RX_MEMSIZE) <= 8192) ? 1 : -1];
+typedef char w5100_tx_check[(W5100_BUF_TOTAL(W5100_TX_MEMSIZE) <= 8192) ? 1 : -1];
+
+#ifdef W5100_HOST
+
+void w5100_host_select(uint8_t on);
+uint8_t w5100_host_xfer(uint8_t data);
+static inline void w5100_select(void) { w5100_host_select(1); }
+static inline void w5100_deselect(void) { w5100_host_select(0); }
+static inline uint8_t w5100_xfer(uint8_t data) { return w5100_host_xfer(data); }
+static inline void w5100_wait(void) { }
+#define PROGMEM
+#define pgm_read_word(p) (*(p))
+
+#else
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+
+static inline void w5100_select(void)
+{
+  // Activate the CS pin
+  SPI_PORT &= ~(1<<SPI_CS);
+}
+
+static inline void w5100_deselect(void)
+{
+  // CS pin is not active
+  SPI_PORT |= (1<<SPI_CS);
+}
+
+static inline uint8_t w5100_xfer(uint8_t data)
+{
+  SPDR = data;
+  // Wait for transmission complete
+  while(!(SPSR & (1<<SPIF)));
+  return SPDR;
+}
+
+static inline void w5100_wait(void)
+{
+  _delay_ms(1);
+}
+
+#endif
+
+// Per socket buffer layout, folded from the memory size settings
+static const uint16_t tx_base[SOCK_MAX] PROGMEM = {
+  TX_BUF_BASE(0),TX_BUF_BASE(1),TX_BUF_BASE(2),TX_BUF_BASE(3)
+};
+static const uint16_t tx_mask[SOCK_MAX] PROGMEM = {
+  TX_BUF_MASK(0),TX_BUF_MASK(1),TX_BUF_MASK(2),TX_BUF_MASK(3)
+};
+static const uint16_t rx_base[SOCK_MAX] PROGMEM = {
+  RX_BUF_BASE(0),RX_BUF_BASE(1),RX_BUF_BASE(2),RX_BUF_BASE(3)
+};
+static const uint16_t rx_mask[SOCK_MAX] PROGMEM = {
+  RX_BUF_MASK(0),RX_BUF_MASK(1),RX_BUF_MASK(2),RX_BUF_MASK(3)
+};
+
+void w5100_spi_init(void)
+{
+#ifndef W5100_HOST
+  // Set MOSI (PORTB3),SCK (PORTB5) and PORTB2 (SS) as output, others as input
+  SPI_DDR = (1<<PORTB3)|(1<<PORTB5)|(1<<PORTB2);
+  // CS pin is not active
+  SPI_PORT |= (1<<SPI_CS);
+  // Enable SPI, Master Mode 0, set the clock rate fck/2
+  SPCR = (1<<SPE)|(1<<MSTR);
+  SPSR |= (1<<SPI2X);
+#endif
+}
+
+void w5100_write8(uint16_t addr,uint8_t data)
+{
+  w5100_select();
+  w5100_xfer(WIZNET_WRITE_OPCODE);
+  w5100_xfer(addr >> 8);
+  w5100_xfer(addr & 0xFF);
+  w5100_xfer(data);
+  w5100_deselect();
+}
+
+uint8_t w5100_read8(uint16_t addr)
+{
+  uint8_t data;
+
+  w5100_select();
+  w5100_xfer(WIZNET_READ_OPCODE);
+  w5100_xfer(addr >> 8);
+  w5100_xfer(addr & 0xFF);
+  // Send Dummy transmission for reading the data
+  data = w5100_xfer(0x00);
+  w5100_deselect();
+  return data;
+}
+
+// 16 bit registers are big endian, high byte at the lower address
+void w5100_write16(uint16_t addr,uint16_t data)
+{
+  w5100_write8(addr,data >> 8);
+  w5100_write8(addr + 1,data & 0xFF);
+}
+
+uint16_t w5100_read16(uint16_t addr)
+{
+  uint16_t data = w5100_read8(addr);
+
+  return (data << 8) | w5100_read8(addr + 1);
+}
+
+void w5100_write_block(uint16_t addr,const uint8_t *data,uint16_t len)
+{
+  while (len--)
+    w5100_write8(addr++,*data++);
+}
+
+void w5100_read_block(uint16_t addr,uint8_t *data,uint16_t len)
+{
+  while (len--)
+    *data++ = w5100_read8(addr++);
+}
+
+// Write runs of registers, optionally reading them all back afterwards.
+// Returns 1 if every register holds what was written.
+uint8_t w5100_program(const w5100_block_t *blocks,uint8_t n,uint8_t verify)
+{
+  uint8_t i,j;
+
+  for (i = 0; i < n; i++)
+    w5100_write_block(blocks[i].addr,blocks[i].data,blocks[i].len);
+  if (!verify) return 1;
+
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < blocks[i].len; j++) {
+      if (w5100_read8(blocks[i].addr + j) != blocks[i].data[j])
+        return 0;
+    }
+  }
+  return 1;
+}
+
+// Reset the chip and program the network and memory registers. Returns 1
+// when the read back matches.
+uint8_t w5100_init(const w5100_net_t *net)
+{
+  const uint8_t memsize[2] = {W5100_RX_MEMSIZE,W5100_TX_MEMSIZE};
+  const w5100_block_t blocks[] = {
+    {GAR,sizeof(w5100_net_t),(const uint8_t *)net},
+    {RMSR,2,memsize},                  // RMSR and TMSR are adjacent
+  };
+
+  // Software reset, the bit clears itself when done
+  w5100_write8(MR,0x80);
+  while (w5100_read8(MR) & 0x80);
+
+  return w5100_program(blocks,sizeof(blocks) / sizeof(blocks[0]),1);
+}
+
+// Issue a socket command and wait for the W5100 to accept it
+static void w5100_command(uint8_t sock,uint8_t cmd)
+{
+  w5100_write8(SOCK_BASE(sock) + Sn_CR,cmd);
+  while (w5100_read8(SOCK_BASE(sock) + Sn_CR));
+}
+
+uint8_t w5100_status(uint8_t sock)
+{
+  return w5100_read8(SOCK_BASE(sock) + Sn_SR);
+}
+
+void w5100_close(uint8_t sock)
+{
+  if (sock >= SOCK_MAX) return;
+  w5100_command(sock,CR_CLOSE);
+}
+
+void w5100_disconnect(uint8_t sock)
+{
+  if (sock >= SOCK_MAX) return;
+  w5100_command(sock,CR_DISCON);
+}
+
+uint8_t w5100_socket(uint8_t sock,uint8_t eth_protocol,uint16_t port)
+{
+  if (sock >= SOCK_MAX) return 0;
+
+  // Make sure we close the socket first
+  if (w5100_status(sock) != SOCK_CLOSED)
+    w5100_close(sock);
+  w5100_write8(SOCK_BASE(sock) + Sn_MR,eth_protocol);
+  w5100_write16(SOCK_BASE(sock) + Sn_PORT,port);
+  w5100_command(sock,CR_OPEN);
+
+  switch (w5100_status(sock)) {
+    case SOCK_INIT:
+    case SOCK_UDP:
+    case SOCK_IPRAW:
+    case SOCK_MACRAW:
+      return 1;
+  }
+  w5100_close(sock);
+  return 0;
+}
+
+uint8_t w5100_listen(uint8_t sock)
+{
+  if (sock >= SOCK_MAX || w5100_status(sock) != SOCK_INIT) return 0;
+
+  w5100_command(sock,CR_LISTEN);
+  if (w5100_status(sock) == SOCK_LISTEN)
+    return 1;
+  w5100_close(sock);
+  return 0;
+}
+
+uint16_t w5100_send(uint8_t sock,const uint8_t *buf,uint16_t buflen)
+{
+  uint16_t base = SOCK_BASE(sock);
+  uint16_t offaddr,timeout,buf_base,mask;
+
+  if (buflen == 0 || sock >= SOCK_MAX) return 0;
+
+  // Wait for room in the Tx buffer, for approx 5000 ms
+  timeout = 0;
+  while (w5100_read16(base + Sn_TX_FSR) < buflen) {
+    w5100_wait();
+    if (timeout++ > 5000) {
+      w5100_disconnect(sock);
+      return 0;
+    }
+  }
+
+  buf_base = pgm_read_word(&tx_base[sock]);
+  mask = pgm_read_word(&tx_mask[sock]);
+  offaddr = w5100_read16(base + Sn_TX_WR);
+  while (buflen--) {
+    w5100_write8(buf_base + (offaddr & mask),*buf++);
+    offaddr++;
+  }
+  // Advance Sn_TX_WR past the data and send it
+  w5100_write16(base + Sn_TX_WR,offaddr);
+  w5100_command(sock,CR_SEND);
+  return 1;
+}
+
+// Send one UDP datagram to ip:port
+uint16_t w5100_sendto(uint8_t sock,const uint8_t *buf,uint16_t buflen,const uint8_t *ip,uint16_t port)
+{
+  if (sock >= SOCK_MAX) return 0;
+  w5100_write_block(SOCK_BASE(sock) + Sn_DIPR,ip,4);
+  w5100_write16(SOCK_BASE(sock) + Sn_DPORT,port);
+  return w5100_send(sock,buf,buflen);
+}
+
+// Read buflen bytes into buf and NUL terminate it; buf must hold
+// buflen + 1 bytes
+uint16_t w5100_recv(uint8_t sock,uint8_t *buf,uint16_t buflen)
+{
+  uint16_t base = SOCK_BASE(sock);
+  uint16_t offaddr,buf_base,mask;
+
+  if (buflen == 0 || sock >= SOCK_MAX) return 1;
+
+  buf_base = pgm_read_word(&rx_base[sock]);
+  mask = pgm_read_word(&rx_mask[sock]);
+  offaddr = w5100_read16(base + Sn_RX_RD);
+  while (buflen--) {
+    *buf++ = w5100_read8(buf_base + (offaddr & mask));
+    offaddr++;
+  }
+  *buf = '\0';        // String terminated character
+
+  // Advance Sn_RX_RD past the data and release it
+  w5100_write16(base + Sn_RX_RD,offaddr);
+  w5100_command(sock,CR_RECV);
+  return 1;
+}
+
+uint16_t w5100_recv_size(uint8_t sock)
+{
+  return w5100_read16(SOCK_BASE(sock) + Sn_RX_RSR);
+}
@@ -0,0 +1,153 @@
+/*****************************************************************************
+//  File Name    : w5100.h
+//  Description  : Wiznet W5100 driver shared by the OpenRemote firmware
+//  Target       : AVRJazz Mega328 Board
+//
+//  Register addresses, socket register offsets and the socket buffer
+//  layout are all compile time constants. Buffer bases and masks come from
+//  W5100_RX_MEMSIZE / W5100_TX_MEMSIZE, the values written to RMSR / TMSR,
+//  so a project only has to pick its memory split.
+*****************************************************************************/
+#ifndef W5100_H
+#define W5100_H
+
+#include <stdint.h>
+
+// AVRJazz Mega328 SPI I/O
+#define SPI_PORT PORTB
+#define SPI_DDR  DDRB
+#define SPI_CS   PORTB2
+// Wiznet W5100 Op Code
+#define WIZNET_WRITE_OPCODE 0xF0
+#define WIZNET_READ_OPCODE 0x0F
+// Wiznet W5100 Register Addresses
+#define MR         0x0000      // Mode Register
+#define GAR        0x0001      // Gateway Address: 0x0001 to 0x0004
+#define SUBR       0x0005      // Subnet mask Address: 0x0005 to 0x0008
+#define SAR        0x0009      // Source Hardware Address (MAC): 0x0009 to 0x000E
+#define SIPR       0x000F      // Source IP Address: 0x000F to 0x0012
+#define RMSR       0x001A      // RX Memory Size Register
+#define TMSR       0x001B      // TX Memory Size Register
+#define TXBUFADDR  0x4000      // W5100 Send Buffer Base Address
+#define RXBUFADDR  0x6000      // W5100 Read Buffer Base Address
+// Socket n registers, offsets from SOCK_BASE(n)
+#define SOCK_BASE(s) (0x0400 + ((uint16_t)(s) << 8))
+#define Sn_MR      0x00        // Mode Register
+#define Sn_CR      0x01        // Command Register
+#define Sn_IR      0x02        // Interrupt Register
+#define Sn_SR      0x03        // Status Register
+#define Sn_PORT    0x04        // Source Port: 2 bytes
+#define Sn_DHAR    0x06        // Destination Hardware Address: 6 bytes
+#define Sn_DIPR    0x0C        // Destination IP Address: 4 bytes
+#define Sn_DPORT   0x10        // Destination Port: 2 bytes
+#define Sn_TX_FSR  0x20        // Tx Free Size Register: 2 bytes
+#define Sn_TX_RD   0x22        // Tx Read Pointer Register: 2 bytes
+#define Sn_TX_WR   0x24        // Tx Write Pointer Register: 2 bytes
+#define Sn_RX_RSR  0x26        // Rx Received Size Register: 2 bytes
+#define Sn_RX_RD   0x28        // Rx Read Pointer: 2 bytes
+// Socket 0 registers
+#define S0_MR      (SOCK_BASE(0) + Sn_MR)
+#define S0_CR      (SOCK_BASE(0) + Sn_CR)
+#define S0_IR      (SOCK_BASE(0) + Sn_IR)
+#define S0_SR      (SOCK_BASE(0) + Sn_SR)
+#define S0_PORT    (SOCK_BASE(0) + Sn_PORT)
+// Sn_MR values
+#define MR_CLOSE	  0x00    // Unused socket
+#define MR_TCP		  0x01    // TCP
+#define MR_UDP		  0x02    // UDP
+#define MR_IPRAW	  0x03	  // IP LAYER RAW SOCK
+#define MR_MACRAW	  0x04	  // MAC LAYER RAW SOCK
+#define MR_PPPOE	  0x05	  // PPPoE
+#define MR_ND			  0x20	  // No Delayed Ack(TCP) flag
+#define MR_MULTI	  0x80	  // support multicating
+// Sn_CR values
+#define CR_OPEN          0x01	  // Initialize or open socket
+#define CR_LISTEN        0x02	  // Wait connection request in tcp mode(Server mode)
+#define CR_CONNECT       0x04	  // Send connection request in tcp mode(Client mode)
+#define CR_DISCON        0x08	  // Send closing reqeuset in tcp mode
+#define CR_CLOSE         0x10	  // Close socket
+#define CR_SEND          0x20	  // Update Tx memory pointer and send data
+#define CR_SEND_MAC      0x21	  // Send data with MAC address, so without ARP process
+#define CR_SEND_KEEP     0x22	  // Send keep alive message
+#define CR_RECV          0x40	  // Update Rx memory buffer pointer and receive data
+// Sn_SR values
+#define SOCK_CLOSED      0x00     // Closed
+#define SOCK_INIT        0x13	  // Init state
+#define SOCK_LISTEN      0x14	  // Listen state
+#define SOCK_SYNSENT     0x15	  // Connection state
+#define SOCK_SYNRECV     0x16	  // Connection state
+#define SOCK_ESTABLISHED 0x17	  // Success to connect
+#define SOCK_FIN_WAIT    0x18	  // Closing state
+#define SOCK_CLOSING     0x1A	  // Closing state
+#define SOCK_TIME_WAIT	 0x1B	  // Closing state
+#define SOCK_CLOSE_WAIT  0x1C	  // Closing state
+#define SOCK_LAST_ACK    0x1D	  // Closing state
+#define SOCK_UDP         0x22	  // UDP socket
+#define SOCK_IPRAW       0x32	  // IP raw mode socket
+#define SOCK_MACRAW      0x42	  // MAC raw mode socket
+#define SOCK_PPPOE       0x5F	  // PPPOE socket
+
+#define SOCK_MAX         4
+
+// RMSR / TMSR values: two bits per socket, 1K << n. The default gives
+// every socket 2K, the W5100 reset value.
+#ifndef W5100_MEMSIZE
+#define W5100_MEMSIZE    0x55
+#endif
+#ifndef W5100_RX_MEMSIZE
+#define W5100_RX_MEMSIZE W5100_MEMSIZE
+#endif
+#ifndef W5100_TX_MEMSIZE
+#define W5100_TX_MEMSIZE W5100_MEMSIZE
+#endif
+
+// Socket buffer size, mask and offset for a memory size register value
+#define W5100_BUF_SIZE(msr,s)  (1024U << (((msr) >> ((s) * 2)) & 0x03))
+#define W5100_BUF_MASK(msr,s)  (W5100_BUF_SIZE(msr,s) - 1)
+#define W5100_BUF_OFF(msr,s)   (((s) > 0 ? W5100_BUF_SIZE(msr,0) : 0) + \
+                                ((s) > 1 ? W5100_BUF_SIZE(msr,1) : 0) + \
+                                ((s) > 2 ? W5100_BUF_SIZE(msr,2) : 0))
+#define W5100_BUF_TOTAL(msr)   (W5100_BUF_OFF(msr,3) + W5100_BUF_SIZE(msr,3))
+
+#define TX_BUF_BASE(s)   (TXBUFADDR + W5100_BUF_OFF(W5100_TX_MEMSIZE,s))
+#define TX_BUF_MASK(s)   W5100_BUF_MASK(W5100_TX_MEMSIZE,s)
+#define RX_BUF_BASE(s)   (RXBUFADDR + W5100_BUF_OFF(W5100_RX_MEMSIZE,s))
+#define RX_BUF_MASK(s)   W5100_BUF_MASK(W5100_RX_MEMSIZE,s)
+
+// Network settings, in the order of the GAR..SIPR registers so they can
+// be programmed as one block
+typedef struct {
+  uint8_t gateway[4];          // GAR
+  uint8_t subnet[4];           // SUBR
+  uint8_t mac[6];              // SAR
+  uint8_t ip[4];               // SIPR
+} w5100_net_t;
+
+// One run of consecutive registers for w5100_program()
+typedef struct {
+  uint16_t addr;
+  uint8_t len;
+  const uint8_t *data;
+} w5100_block_t;
+
+void w5100_spi_init(void);
+void w5100_write8(uint16_t addr,uint8_t data);
+uint8_t w5100_read8(uint16_t addr);
+void w5100_write16(uint16_t addr,uint16_t data);
+uint16_t w5100_read16(uint16_t addr);
+void w5100_write_block(uint16_t addr,const uint8_t *data,uint16_t len);
+void w5100_read_block(uint16_t addr,uint8_t *data,uint16_t len);
+uint8_t w5100_program(const w5100_block_t *blocks,uint8_t n,uint8_t verify);
+uint8_t w5100_init(const w5100_net_t *net);
+
+uint8_t w5100_socket(uint8_t sock,uint8_t eth_protocol,uint16_t port);
+uint8_t w5100_listen(uint8_t sock);
+void w5100_close(uint8_t sock);
+void w5100_disconnect(uint8_t sock);
+uint8_t w5100_status(uint8_t sock);
+uint16_t w5100_send(uint8_t sock,const uint8_t *buf,uint16_t buflen);
+uint16_t w5100_sendto(uint8_t sock,const uint8_t *buf,uint16_t buflen,const uint8_t *ip,uint16_t port);
+uint16_t w5100_recv(uint8_t sock,uint8_t *buf,uint16_t buflen);
+uint16_t w5100_recv_size(uint8_t sock);
+
+#endif
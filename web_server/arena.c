@@ -0,0 +1,157 @@
+/*****************************************************************************
+//  File Name    : arena.c
+//  Description  : Fixed-block buffer arena for the OpenRemote web server
+//  Target       : AVRJazz Mega328 Board
+//
+//  The arena is carved into ARENA_BLOCKS blocks of ARENA_BLOCK_SIZE bytes.
+//  Each allocation is a contiguous run of blocks tagged with its owner, so
+//  the request, the response and a decoded code can live side by side
+//  instead of taking turns in one shared buffer. The stored code is the
+//  one region that outlives a request, so it is placed from the top down
+//  and the rest always find one free run below it.
+//
+//  The arena is most of SRAM, and what is left between the globals and
+//  the stack is painted at start up; arena_stack_free() reports how much
+//  of it the stack has never reached.
+*****************************************************************************/
+#include <stddef.h>
+#include <avr/io.h>
+#include "arena.h"
+
+// Block map: low bits hold the owner, ARENA_HEAD marks the first block
+// of an allocation so arena_free() knows where a run ends
+#define ARENA_HEAD   0x80
+#define ARENA_OWNER  0x7F
+
+#define STACK_PAINT  0xA5
+#define STACK_GUARD  64         // Left for interrupts taken while painting
+
+// Every allocation is a run of at most 255 blocks
+typedef char arena_size_check[(ARENA_BLOCKS <= 255) ? 1 : -1];
+
+extern uint8_t __heap_start;    // End of .data and .bss, from the linker
+
+static uint8_t arena[ARENA_SIZE];
+static uint8_t arena_map[ARENA_BLOCKS];
+static uint8_t arena_used;
+static uint8_t arena_peak;
+
+void arena_init(void)
+{
+  uint8_t i,*p;
+
+  for (i = 0; i < ARENA_BLOCKS; i++)
+    arena_map[i] = ARENA_FREE;
+  arena_used = 0;
+  arena_peak = 0;
+
+  for (p = &__heap_start; p < (uint8_t *)SP - STACK_GUARD; p++)
+    *p = STACK_PAINT;
+}
+
+uint8_t *arena_alloc(uint8_t owner,uint16_t len)
+{
+  uint8_t i,j,start,run,need;
+
+  if (owner == ARENA_FREE || owner >= ARENA_OWNERS || len == 0) return NULL;
+  if (len > ARENA_SIZE) return NULL;
+  need = ARENA_BLOCKS_FOR(len);
+
+  // First fit search for a free run of blocks, from the top for the code
+  run = 0;
+  start = 0;
+  for (i = 0; i < ARENA_BLOCKS; i++) {
+    j = (owner == ARENA_CODE) ? ARENA_BLOCKS - 1 - i : i;
+    if (arena_map[j] != ARENA_FREE) {
+      run = 0;
+      continue;
+    }
+    if (run++ == 0 || owner == ARENA_CODE)
+      start = j;
+    if (run == need) {
+      arena_map[start] = owner | ARENA_HEAD;
+      for (i = start + 1; i < start + need; i++)
+        arena_map[i] = owner;
+
+      arena_used += need;
+      if (arena_used > arena_peak)
+        arena_peak = arena_used;
+      return arena + (uint16_t)start * ARENA_BLOCK_SIZE;
+    }
+  }
+  return NULL;
+}
+
+void arena_free(uint8_t *ptr)
+{
+  uint8_t i,owner;
+
+  if (ptr < arena || ptr >= arena + ARENA_SIZE) return;
+  i = (ptr - arena) / ARENA_BLOCK_SIZE;
+  if (!(arena_map[i] & ARENA_HEAD)) return;
+
+  owner = arena_map[i] & ARENA_OWNER;
+  arena_map[i++] = ARENA_FREE;
+  arena_used--;
+  while (i < ARENA_BLOCKS && arena_map[i] == owner) {
+    arena_map[i++] = ARENA_FREE;
+    arena_used--;
+  }
+}
+
+void arena_release(uint8_t owner)
+{
+  uint8_t i;
+
+  for (i = 0; i < ARENA_BLOCKS; i++) {
+    if (arena_map[i] != ARENA_FREE && (arena_map[i] & ARENA_OWNER) == owner) {
+      arena_map[i] = ARENA_FREE;
+      arena_used--;
+    }
+  }
+}
+
+// Largest single allocation currently possible, in bytes
+uint16_t arena_avail(void)
+{
+  uint8_t i,run,best;
+
+  run = 0;
+  best = 0;
+  for (i = 0; i < ARENA_BLOCKS; i++) {
+    if (arena_map[i] == ARENA_FREE) {
+      if (++run > best)
+        best = run;
+    } else {
+      run = 0;
+    }
+  }
+  return (uint16_t)best * ARENA_BLOCK_SIZE;
+}
+
+uint16_t arena_in_use(uint8_t owner)
+{
+  uint8_t i,n;
+
+  n = 0;
+  for (i = 0; i < ARENA_BLOCKS; i++) {
+    if (arena_map[i] != ARENA_FREE && (arena_map[i] & ARENA_OWNER) == owner)
+      n++;
+  }
+  return (uint16_t)n * ARENA_BLOCK_SIZE;
+}
+
+uint16_t arena_high_water(void)
+{
+  return (uint16_t)arena_peak * ARENA_BLOCK_SIZE;
+}
+
+// Bytes between the globals and the stack that the stack has never used
+uint16_t arena_stack_free(void)
+{
+  const uint8_t *p = &__heap_start;
+
+  while (p < (const uint8_t *)RAMEND && *p == STACK_PAINT)
+    p++;
+  return p - &__heap_start;
+}
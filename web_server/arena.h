@@ -0,0 +1,36 @@
+/*****************************************************************************
+//  File Name    : arena.h
+//  Description  : Fixed-block buffer arena for the OpenRemote web server
+//  Target       : AVRJazz Mega328 Board
+*****************************************************************************/
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+
+// Arena geometry, fixed at compile time
+#define ARENA_BLOCK_SIZE   32      // Bytes per block
+#define ARENA_BLOCKS       34      // Number of blocks (1088 bytes total)
+#define ARENA_SIZE         (ARENA_BLOCK_SIZE * ARENA_BLOCKS)
+
+// Region owners
+#define ARENA_FREE         0x00    // Block not allocated
+#define ARENA_RX           0x01    // Incoming request data
+#define ARENA_TX           0x02    // Outgoing response data
+#define ARENA_CODE         0x03    // Decoded IR code
+#define ARENA_SCRATCH      0x04    // Short lived working storage
+#define ARENA_OWNERS       5
+
+// Number of blocks needed to hold len bytes
+#define ARENA_BLOCKS_FOR(len) (((len) + ARENA_BLOCK_SIZE - 1) / ARENA_BLOCK_SIZE)
+
+void arena_init(void);
+uint8_t *arena_alloc(uint8_t owner,uint16_t len);
+void arena_free(uint8_t *ptr);
+void arena_release(uint8_t owner);
+uint16_t arena_avail(void);
+uint16_t arena_in_use(uint8_t owner);
+uint16_t arena_high_water(void);
+uint16_t arena_stack_free(void);
+
+#endif
@@ -0,0 +1,173 @@
+/*****************************************************************************
+//  File Name    : assets.c
+//  Description  : Static web assets, generated by tools/mkassets.py
+//                 from www/ - do not edit
+*****************************************************************************/
+#include "assets.h"
+
+// /favicon.ico: 1150 bytes, 97 gzipped
+static const char favicon_ico_path[] PROGMEM = "/favicon.ico";
+static const char favicon_ico_type[] PROGMEM = "image/x-icon";
+static const char favicon_ico_etag[] PROGMEM = "55be15d1";
+static const uint8_t favicon_ico_raw[] PROGMEM = {
+  0x00,0x00,0x01,0x00,0x01,0x00,0x10,0x10,0x00,0x00,0x01,0x00,0x20,0x00,0x68,0x04,
+  0x00,0x00,0x16,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x20,0x00,
+  0x00,0x00,0x01,0x00,0x20,0x00,0x00,0x00,0x00,0x00,0x40,0x04,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,
+  0x00,0xff,0xa0,0x00,0x00,0xff,0xa0,0x00,0x00,0xff,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+};
+static const uint8_t favicon_ico_gz[] PROGMEM = {
+  0x1f,0x8b,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0x63,0x60,0x60,0x04,0x42,0x01,
+  0x01,0x06,0x20,0xa9,0xc0,0x90,0xc1,0xc2,0xc0,0x20,0xc6,0xc0,0xc0,0xa0,0x01,0xc4,
+  0x40,0x21,0xa0,0x08,0x44,0x1c,0x04,0x1c,0x58,0x18,0xe8,0x02,0x16,0x30,0x30,0xfc,
+  0xc7,0x86,0x29,0xd1,0x4b,0x8c,0x19,0x84,0xf4,0xe2,0x33,0x83,0x58,0xbd,0xd8,0xcc,
+  0x20,0x55,0x2f,0xba,0x19,0xa3,0xfa,0x29,0xd3,0x4f,0x69,0xfc,0x51,0x23,0xfd,0x50,
+  0x23,0xfd,0x52,0x23,0xff,0xd0,0x1b,0x00,0x00,0x66,0x2b,0x7a,0x3a,0x7e,0x04,0x00,
+  0x00,
+};
+
+// /: 621 bytes, 402 gzipped
+static const char index_html_path[] PROGMEM = "/";
+static const char index_html_type[] PROGMEM = "text/html";
+static const char index_html_etag[] PROGMEM = "57b03287";
+static const uint8_t index_html_raw[] PROGMEM = {
+  0x3c,0x68,0x74,0x6d,0x6c,0x3e,0x3c,0x68,0x65,0x61,0x64,0x3e,0x3c,0x74,0x69,0x74,
+  0x6c,0x65,0x3e,0x4f,0x70,0x65,0x6e,0x52,0x65,0x6d,0x6f,0x74,0x65,0x3c,0x2f,0x74,
+  0x69,0x74,0x6c,0x65,0x3e,0x3c,0x2f,0x68,0x65,0x61,0x64,0x3e,0x0a,0x3c,0x62,0x6f,
+  0x64,0x79,0x3e,0x3c,0x73,0x70,0x61,0x6e,0x20,0x73,0x74,0x79,0x6c,0x65,0x3d,0x22,
+  0x63,0x6f,0x6c,0x6f,0x72,0x3a,0x23,0x30,0x30,0x30,0x30,0x41,0x30,0x22,0x3e,0x0a,
+  0x3c,0x68,0x31,0x3e,0x4f,0x70,0x65,0x6e,0x52,0x65,0x6d,0x6f,0x74,0x65,0x3c,0x2f,
+  0x68,0x31,0x3e,0x0a,0x3c,0x68,0x33,0x3e,0x50,0x6c,0x65,0x61,0x73,0x65,0x20,0x45,
+  0x6e,0x74,0x65,0x72,0x20,0x50,0x72,0x6f,0x6e,0x74,0x6f,0x20,0x43,0x6f,0x64,0x65,
+  0x20,0x42,0x65,0x6c,0x6f,0x77,0x3a,0x3c,0x2f,0x68,0x33,0x3e,0x0a,0x3c,0x70,0x3e,
+  0x3c,0x66,0x6f,0x72,0x6d,0x20,0x6d,0x65,0x74,0x68,0x6f,0x64,0x3d,0x22,0x50,0x4f,
+  0x53,0x54,0x22,0x3e,0x0a,0x43,0x6f,0x64,0x65,0x3a,0x20,0x3c,0x74,0x65,0x78,0x74,
+  0x61,0x72,0x65,0x61,0x20,0x69,0x64,0x3d,0x22,0x63,0x6f,0x64,0x65,0x22,0x20,0x6e,
+  0x61,0x6d,0x65,0x3d,0x22,0x63,0x6f,0x64,0x65,0x22,0x20,0x72,0x6f,0x77,0x73,0x3d,
+  0x22,0x35,0x22,0x20,0x63,0x6f,0x6c,0x73,0x3d,0x22,0x33,0x30,0x22,0x3e,0x3c,0x2f,
+  0x74,0x65,0x78,0x74,0x61,0x72,0x65,0x61,0x3e,0x3c,0x62,0x72,0x20,0x2f,0x3e,0x0a,
+  0x3c,0x69,0x6e,0x70,0x75,0x74,0x20,0x74,0x79,0x70,0x65,0x3d,0x22,0x73,0x75,0x62,
+  0x6d,0x69,0x74,0x22,0x3e,0x0a,0x3c,0x2f,0x66,0x6f,0x72,0x6d,0x3e,0x3c,0x61,0x20,
+  0x68,0x72,0x65,0x66,0x3d,0x22,0x2f,0x6c,0x65,0x61,0x72,0x6e,0x22,0x3e,0x4c,0x65,
+  0x61,0x72,0x6e,0x3c,0x2f,0x61,0x3e,0x20,0x3c,0x73,0x70,0x61,0x6e,0x20,0x69,0x64,
+  0x3d,0x22,0x73,0x74,0x61,0x74,0x75,0x73,0x22,0x3e,0x3c,0x2f,0x73,0x70,0x61,0x6e,
+  0x3e,0x3c,0x2f,0x70,0x3e,0x3c,0x2f,0x73,0x70,0x61,0x6e,0x3e,0x0a,0x3c,0x73,0x63,
+  0x72,0x69,0x70,0x74,0x3e,0x0a,0x66,0x75,0x6e,0x63,0x74,0x69,0x6f,0x6e,0x20,0x67,
+  0x65,0x74,0x28,0x75,0x2c,0x66,0x29,0x7b,0x76,0x61,0x72,0x20,0x72,0x3d,0x6e,0x65,
+  0x77,0x20,0x58,0x4d,0x4c,0x48,0x74,0x74,0x70,0x52,0x65,0x71,0x75,0x65,0x73,0x74,
+  0x28,0x29,0x3b,0x72,0x2e,0x6f,0x6e,0x6c,0x6f,0x61,0x64,0x3d,0x66,0x75,0x6e,0x63,
+  0x74,0x69,0x6f,0x6e,0x28,0x29,0x7b,0x66,0x28,0x72,0x2e,0x72,0x65,0x73,0x70,0x6f,
+  0x6e,0x73,0x65,0x54,0x65,0x78,0x74,0x29,0x7d,0x3b,0x72,0x2e,0x6f,0x70,0x65,0x6e,
+  0x28,0x22,0x47,0x45,0x54,0x22,0x2c,0x75,0x29,0x3b,0x72,0x2e,0x73,0x65,0x6e,0x64,
+  0x28,0x29,0x7d,0x0a,0x67,0x65,0x74,0x28,0x22,0x2f,0x63,0x6f,0x64,0x65,0x22,0x2c,
+  0x66,0x75,0x6e,0x63,0x74,0x69,0x6f,0x6e,0x28,0x74,0x29,0x7b,0x64,0x6f,0x63,0x75,
+  0x6d,0x65,0x6e,0x74,0x2e,0x67,0x65,0x74,0x45,0x6c,0x65,0x6d,0x65,0x6e,0x74,0x42,
+  0x79,0x49,0x64,0x28,0x22,0x63,0x6f,0x64,0x65,0x22,0x29,0x2e,0x76,0x61,0x6c,0x75,
+  0x65,0x3d,0x74,0x7d,0x29,0x3b,0x0a,0x67,0x65,0x74,0x28,0x22,0x2f,0x73,0x74,0x61,
+  0x74,0x75,0x73,0x22,0x2c,0x66,0x75,0x6e,0x63,0x74,0x69,0x6f,0x6e,0x28,0x74,0x29,
+  0x7b,0x64,0x6f,0x63,0x75,0x6d,0x65,0x6e,0x74,0x2e,0x67,0x65,0x74,0x45,0x6c,0x65,
+  0x6d,0x65,0x6e,0x74,0x42,0x79,0x49,0x64,0x28,0x22,0x73,0x74,0x61,0x74,0x75,0x73,
+  0x22,0x29,0x2e,0x74,0x65,0x78,0x74,0x43,0x6f,0x6e,0x74,0x65,0x6e,0x74,0x3d,0x74,
+  0x7d,0x29,0x3b,0x0a,0x3c,0x2f,0x73,0x63,0x72,0x69,0x70,0x74,0x3e,0x0a,0x3c,0x2f,
+  0x62,0x6f,0x64,0x79,0x3e,0x3c,0x2f,0x68,0x74,0x6d,0x6c,0x3e,0x0a,
+};
+static const uint8_t index_html_gz[] PROGMEM = {
+  0x1f,0x8b,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0x8d,0x52,0xc1,0x6e,0xe3,0x20,
+  0x10,0xbd,0xfb,0x2b,0x10,0x7b,0x31,0x52,0x64,0xba,0x8a,0x7a,0x49,0x31,0xd2,0xb6,
+  0x8a,0xba,0x2b,0xb5,0x6a,0xd4,0xcd,0xa1,0x57,0x12,0xc6,0xb5,0x25,0x1b,0xbc,0x30,
+  0x34,0x1b,0x45,0xf9,0xf7,0x1d,0x62,0x67,0xa5,0xde,0xca,0x85,0x61,0x78,0xf3,0xde,
+  0xcc,0x03,0xd5,0xe2,0xd0,0x6b,0xd5,0x82,0xb1,0x5a,0x61,0x87,0x3d,0xe8,0x97,0x11,
+  0xdc,0x2b,0x0c,0x1e,0x41,0xc9,0x29,0xa3,0xe4,0xe5,0xbe,0x50,0x3b,0x6f,0x8f,0x5a,
+  0xc5,0xd1,0x38,0x16,0xf1,0xd8,0x43,0xcd,0xf7,0xbe,0xf7,0x61,0xf5,0xed,0x86,0xd6,
+  0x8f,0x1b,0x4e,0x90,0xf6,0xfb,0x27,0x02,0x3a,0x52,0x6e,0xa9,0x37,0x3d,0x98,0x08,
+  0x6c,0xed,0x10,0x02,0xdb,0x04,0xef,0xd0,0xb3,0x07,0x6f,0x81,0xdd,0x43,0xef,0x0f,
+  0x2b,0x02,0x2e,0x09,0x38,0x6a,0xd5,0xf8,0x30,0xb0,0x01,0xb0,0xf5,0xb6,0xe6,0x9b,
+  0x97,0xdf,0x5b,0x22,0xcd,0xc0,0x15,0x53,0x08,0x7f,0xd1,0x04,0x30,0xac,0xb3,0x59,
+  0xd8,0x02,0x67,0xce,0x0c,0x70,0x8d,0x83,0x3f,0xc4,0x9a,0xdf,0x72,0x46,0x3d,0x51,
+  0xb0,0xa4,0x76,0x68,0x80,0xb9,0x46,0xab,0x5d,0x60,0x92,0x24,0x3a,0x37,0x26,0x64,
+  0x78,0x1c,0xa9,0x2e,0xa6,0xdd,0xd0,0x61,0xee,0x5a,0x66,0x59,0xad,0x0c,0x6b,0x03,
+  0x34,0x35,0x97,0xd4,0x6d,0x70,0x5c,0x3f,0xe5,0x4d,0x49,0xa3,0xd9,0x34,0x74,0x16,
+  0x8e,0x68,0x30,0xc5,0xcc,0x9d,0x53,0xb4,0x8d,0xd7,0xb0,0x50,0x71,0x1f,0xba,0x11,
+  0x75,0xd1,0x24,0xb7,0xc7,0xce,0x3b,0xf6,0x0e,0x58,0xa6,0x45,0x23,0x4e,0x1f,0x26,
+  0xb0,0x50,0x3b,0x38,0xb0,0xb7,0xe7,0xa7,0x9f,0x88,0xe3,0x2b,0xfc,0x49,0x10,0xb1,
+  0x14,0x77,0xa1,0xf2,0xae,0xf7,0xc6,0xd6,0xd7,0xaa,0x52,0x9c,0x9a,0x32,0x54,0x01,
+  0xe2,0xe8,0x5d,0x84,0x2d,0x8d,0x20,0xce,0x19,0x46,0xbe,0x96,0xfc,0x71,0xbd,0xe5,
+  0x8b,0x94,0xcb,0x22,0x38,0x5b,0x8a,0x73,0x91,0x45,0xb8,0xbc,0x98,0xb0,0xf8,0xcf,
+  0x81,0xe2,0x64,0xfd,0x3e,0x0d,0xe0,0xb0,0x22,0xc0,0xba,0x87,0x1c,0xde,0x1f,0x7f,
+  0xd9,0x72,0xf2,0x4b,0x54,0x1f,0xa6,0x4f,0x50,0xe3,0x59,0xdc,0xcd,0x14,0xf3,0x68,
+  0x5f,0x23,0x99,0xc1,0xa2,0xca,0x16,0x3f,0xd0,0x83,0xd2,0xcd,0x44,0x46,0x76,0xcc,
+  0x3e,0x28,0x39,0xfd,0x18,0x79,0xf9,0x65,0xc5,0x3f,0x2c,0x3b,0xe0,0xa2,0x6d,0x02,
+  0x00,0x00,
+};
+
+const asset_t assets[ASSET_COUNT] PROGMEM = {
+  {favicon_ico_path,favicon_ico_type,favicon_ico_etag,favicon_ico_raw,1150,favicon_ico_gz,97,ASSET_LONG_CACHE},
+  {index_html_path,index_html_type,index_html_etag,index_html_raw,621,index_html_gz,402,0},
+};
@@ -0,0 +1,28 @@
+/*****************************************************************************
+//  File Name    : assets.h
+//  Description  : Static web assets, generated by tools/mkassets.py
+//                 from www/ - do not edit
+*****************************************************************************/
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#define ASSET_LONG_CACHE 0x01      // Cache without revalidating
+
+typedef struct {
+  PGM_P path;                  // Request path
+  PGM_P type;                  // Content-Type
+  PGM_P etag;                  // ETag of the file, "-gz" is added for the gzip copy
+  const uint8_t *raw;          // File as is
+  uint16_t raw_len;
+  const uint8_t *gz;           // File gzip compressed
+  uint16_t gz_len;
+  uint8_t flags;
+} asset_t;
+
+#define ASSET_COUNT 2
+extern const asset_t assets[ASSET_COUNT] PROGMEM;
+
+#endif
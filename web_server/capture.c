@@ -0,0 +1,89 @@
+/*****************************************************************************
+//  File Name    : capture.c
+//  Description  : Timer/Counter1 input capture (ICP1) edge recorder
+//  Target       : AVRJazz Mega328 Board
+//
+//  Timer1 free runs at Clk/8 (0.5 us per tick) and the capture ISR only
+//  stores ICR1 into the ring, so it keeps up with a raw 40 kHz carrier.
+//  A raw receiver is sampled on rising edges only (one per carrier
+//  period); a demodulating receiver is sampled on both edges, starting
+//  with the falling edge that begins its active-low mark.
+*****************************************************************************/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "capture.h"
+
+static uint16_t *cap_ring;
+static volatile uint8_t cap_head;      // Written by the ISR
+static volatile uint8_t cap_tail;      // Written by capture_read()
+static volatile uint8_t cap_both;      // Capture both edges
+static volatile uint16_t cap_lost;
+
+ISR(TIMER1_CAPT_vect)
+{
+  uint16_t stamp = ICR1;
+  uint8_t next = (cap_head + 1) & CAPTURE_MASK;
+
+  if (cap_both) {
+    // Look for the opposite edge next; changing ICES1 may set ICF1
+    TCCR1B ^= (1<<ICES1);
+    TIFR1 = (1<<ICF1);
+  }
+  if (next == cap_tail) {
+    cap_lost++;
+    return;
+  }
+  cap_ring[cap_head] = stamp;
+  cap_head = next;
+}
+
+// Timer1 is shared with the IR emitter, which must be idle
+void capture_start(uint16_t *ring,uint8_t raw)
+{
+  cap_ring = ring;
+  cap_head = 0;
+  cap_tail = 0;
+  cap_lost = 0;
+  cap_both = !raw;
+
+  CAPTURE_DDR &= ~(1<<CAPTURE_PIN);
+  TIMSK1 = 0;
+  TCCR1A = 0;
+  if (raw)
+    TCCR1B = (1<<ICES1)|(1<<CS11);     // Rising edge, Clk/8
+  else
+    TCCR1B = (1<<ICNC1)|(1<<CS11);     // Falling edge, noise canceler, Clk/8
+  TCNT1 = 0;
+  TIFR1 = (1<<ICF1)|(1<<TOV1);
+  TIMSK1 = (1<<ICIE1);
+}
+
+void capture_stop(void)
+{
+  TIMSK1 = 0;
+  TCCR1B = 0;
+}
+
+uint8_t capture_read(uint16_t *stamp)
+{
+  if (cap_tail == cap_head) return 0;
+  *stamp = cap_ring[cap_tail];
+  cap_tail = (cap_tail + 1) & CAPTURE_MASK;
+  return 1;
+}
+
+uint16_t capture_now(void)
+{
+  uint16_t now;
+  uint8_t sreg = SREG;
+
+  cli();
+  now = TCNT1;
+  SREG = sreg;
+  return now;
+}
+
+uint16_t capture_lost(void)
+{
+  return cap_lost;
+}
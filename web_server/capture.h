@@ -0,0 +1,24 @@
+/*****************************************************************************
+//  File Name    : capture.h
+//  Description  : Timer/Counter1 input capture (ICP1) edge recorder
+//  Target       : AVRJazz Mega328 Board
+*****************************************************************************/
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+// IR receiver input, ICP1
+#define CAPTURE_DDR    DDRB
+#define CAPTURE_PIN    PORTB0
+
+#define CAPTURE_SIZE   128     // Timestamps, must be a power of two
+#define CAPTURE_MASK   (CAPTURE_SIZE - 1)
+
+void capture_start(uint16_t *ring,uint8_t raw);
+void capture_stop(void);
+uint8_t capture_read(uint16_t *stamp);
+uint16_t capture_now(void);
+uint16_t capture_lost(void);
+
+#endif
@@ -0,0 +1,156 @@
+/*****************************************************************************
+//  File Name    : carrier.c
+//  Description  : Timer/Counter2 IR carrier with fractional period dithering
+//  Target       : AVRJazz Mega328 Board
+//
+//  Timer2 runs in fast PWM with TOP in OCR2A and the carrier on OC2B. The
+//  Pronto frequency word sets the period; the smallest prescaler that fits
+//  it in 8 bits gives the finest steps. At Clk/8 a 30-60 kHz carrier is
+//  only 33-67 counts, so a single TOP can be nearly 1.5% off. The period
+//  is therefore kept to 1/256 of a count, and the overflow interrupt
+//  switches between TOP and TOP + 1 so the average comes out right.
+//
+//  The emitter gates the carrier onto the pin for marks with carrier_on()
+//  and carrier_off(). Building with CARRIER_HOST leaves out the hardware
+//  so a host tool can check the plan and the dither.
+*****************************************************************************/
+#ifndef CARRIER_HOST
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(p) (*(p))
+#endif
+#include "carrier.h"
+
+// Carrier period is freq_word * 0.241246 us, in CPU clocks as Q12
+#define CARRIER_TICK_Q12 ((uint32_t)(0.241246 * (F_CPU / 1000000.0) * 4096.0 + 0.5))
+
+// Timer2 prescalers, Clk/1 to Clk/1024, as powers of two; CS22:0 is the
+// index plus one
+static const uint8_t carrier_shifts[] PROGMEM = {0,3,5,6,7,8,10};
+
+// Work out the Timer2 settings for a Pronto frequency word and a duty
+// cycle in percent; returns 0 if the frequency is out of reach
+uint8_t carrier_plan(carrier_t *c,uint16_t freq_word,uint8_t duty)
+{
+  uint32_t clocks = (uint32_t)freq_word * CARRIER_TICK_Q12;
+  uint32_t n = 0;               // Period in timer counts, Q8
+  uint16_t high;
+  uint8_t i,shift;
+
+  shift = 0;
+  for (i = 0; i < sizeof(carrier_shifts); i++) {
+    shift = pgm_read_byte(&carrier_shifts[i]);
+    n = (clocks + (1UL << (3 + shift))) >> (4 + shift);
+    // Leave room for the dithered TOP + 1
+    if (n < (256UL << 8)) break;
+  }
+  if (i == sizeof(carrier_shifts) || n < (4 << 8)) return 0;
+
+  c->cs = i + 1;
+  c->shift = shift;
+  c->top = (n >> 8) - 1;
+  c->frac = n & 0xFF;
+  c->acc = 0;
+
+  // High counts for the duty cycle, keeping at least one count each way
+  if (duty > 100)
+    duty = 100;
+  high = (n * duty / 100 + 128) >> 8;
+  if (high < 1)
+    high = 1;
+  if (high > c->top)
+    high = c->top;
+  c->duty_top = high - 1;
+  return 1;
+}
+
+// Average carrier frequency the plan produces
+uint32_t carrier_hz(const carrier_t *c)
+{
+  uint32_t n = ((uint32_t)(c->top + 1) << 8) + c->frac;
+  uint32_t hz = (F_CPU << 8) / n;
+
+  return (hz + ((1UL << c->shift) >> 1)) >> c->shift;
+}
+
+#ifndef CARRIER_HOST
+
+static carrier_t carrier;
+static uint8_t carrier_pct = CARRIER_DUTY;
+
+// Loads the TOP for the period after next; OCR2A is double buffered
+ISR(TIMER2_OVF_vect)
+{
+  OCR2A = carrier_step(&carrier);
+}
+
+void carrier_init(void)
+{
+  carrier_stop();
+  CARRIER_DDR |= (1<<CARRIER_PIN);
+}
+
+// Run Timer2 at the frequency of a Pronto word, with the pin still off
+uint8_t carrier_start(uint16_t freq_word)
+{
+  carrier_stop();
+  if (!carrier_plan(&carrier,freq_word,carrier_pct)) return 0;
+  OCR2A = carrier.top;
+  OCR2B = carrier.duty_top;
+  TCNT2 = 0;
+  TCCR2A = (1<<WGM21)|(1<<WGM20);     // Fast PWM, TOP = OCR2A with WGM22
+  // A whole number of counts needs no dither
+  if (carrier.frac) {
+    TIFR2 = (1<<TOV2);
+    TIMSK2 = (1<<TOIE2);
+  }
+  TCCR2B = (1<<WGM22) | carrier.cs;
+  return 1;
+}
+
+void carrier_stop(void)
+{
+  TCCR2B = 0;
+  TIMSK2 = 0;
+  TCCR2A = 0;
+  CARRIER_PORT &= ~(1<<CARRIER_PIN);
+}
+
+// Start of a mark: the next count wraps to BOTTOM and starts a full pulse
+void carrier_on(void)
+{
+  TCNT2 = carrier.top;
+  TCCR2A |= (1<<COM2B1);
+}
+
+// Start of a space: the pin falls back to PORTD, which is low
+void carrier_off(void)
+{
+  TCCR2A &= ~(1<<COM2B1);
+}
+
+// Duty cycle in percent, used from the next carrier_start()
+void carrier_set_duty(uint8_t duty)
+{
+  if (duty < 1)
+    duty = 1;
+  if (duty > 99)
+    duty = 99;
+  carrier_pct = duty;
+}
+
+uint8_t carrier_duty(void)
+{
+  return carrier_pct;
+}
+
+// Settings of the last carrier started
+const carrier_t *carrier_current(void)
+{
+  return &carrier;
+}
+
+#endif
@@ -0,0 +1,52 @@
+/*****************************************************************************
+//  File Name    : carrier.h
+//  Description  : Timer/Counter2 IR carrier with fractional period dithering
+//  Target       : AVRJazz Mega328 Board
+*****************************************************************************/
+#ifndef CARRIER_H
+#define CARRIER_H
+
+#include <stdint.h>
+
+// Carrier output, OC2B. OC2A is PB3, which the W5100 needs for MOSI.
+#define CARRIER_PORT   PORTD
+#define CARRIER_DDR    DDRD
+#define CARRIER_PIN    PORTD3
+
+#define CARRIER_DUTY   33      // Default duty cycle, percent
+
+typedef struct {
+  uint8_t cs;                  // Timer2 clock select, CS22:0
+  uint8_t shift;               // Prescaler as a power of two
+  uint8_t top;                 // OCR2A; a period is top + 1 counts
+  uint8_t frac;                // Extra 1/256 count per period, dithered in
+  uint8_t acc;                 // Dither accumulator
+  uint8_t duty_top;            // OCR2B; high for duty_top + 1 counts
+} carrier_t;
+
+// OCR2A for the next period: one count longer whenever the fraction
+// carries, so the average period is top + 1 + frac / 256 counts
+static inline uint8_t carrier_step(carrier_t *c)
+{
+  uint8_t acc = c->acc + c->frac;
+  uint8_t top = c->top + (acc < c->acc);
+
+  c->acc = acc;
+  return top;
+}
+
+uint8_t carrier_plan(carrier_t *c,uint16_t freq_word,uint8_t duty);
+uint32_t carrier_hz(const carrier_t *c);
+
+#ifndef CARRIER_HOST
+void carrier_init(void);
+uint8_t carrier_start(uint16_t freq_word);
+void carrier_stop(void);
+void carrier_on(void);
+void carrier_off(void);
+void carrier_set_duty(uint8_t duty);
+uint8_t carrier_duty(void);
+const carrier_t *carrier_current(void);
+#endif
+
+#endif
@@ -0,0 +1,56 @@
+/*****************************************************************************
+//  File Name    : clock.c
+//  Description  : Timer/Counter0 millisecond clock with microsecond reads
+//  Target       : AVRJazz Mega328 Board
+//
+//  Timer0 runs in CTC mode at Clk/64 and overflows every 1 ms, so TCNT0
+//  gives the time inside the current millisecond in 4 us steps.
+*****************************************************************************/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "clock.h"
+
+#define CLOCK_TOP ((F_CPU / 64 / 1000) - 1)    // 249 at 16 MHz
+
+static volatile uint32_t clock_millis;
+
+ISR(TIMER0_COMPA_vect)
+{
+  clock_millis++;
+}
+
+void clock_init(void)
+{
+  TCCR0A=(1<<WGM01);               // CTC Mode
+  TCCR0B=(1<<CS01)|(1<<CS00);      // Clk/64
+  OCR0A=CLOCK_TOP;                 // Compare match every 1 mSec
+  TCNT0=0;
+  TIMSK0=(1<<OCIE0A);              // Enable Compare Match A Interrupt
+}
+
+uint32_t clock_ms(void)
+{
+  uint32_t ms;
+  uint8_t sreg = SREG;
+
+  cli();
+  ms = clock_millis;
+  SREG = sreg;
+  return ms;
+}
+
+uint32_t clock_us(void)
+{
+  uint32_t ms;
+  uint8_t ticks;
+  uint8_t sreg = SREG;
+
+  cli();
+  ms = clock_millis;
+  ticks = TCNT0;
+  // A pending compare match means TCNT0 has already wrapped
+  if ((TIFR0 & (1<<OCF0A)) && ticks < CLOCK_TOP)
+    ms++;
+  SREG = sreg;
+  return ms * 1000 + (uint32_t)ticks * (64000000UL / F_CPU);
+}
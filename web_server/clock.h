@@ -0,0 +1,15 @@
+/*****************************************************************************
+//  File Name    : clock.h
+//  Description  : Timer/Counter0 millisecond clock with microsecond reads
+//  Target       : AVRJazz Mega328 Board
+*****************************************************************************/
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+void clock_init(void);
+uint32_t clock_ms(void);
+uint32_t clock_us(void);
+
+#endif
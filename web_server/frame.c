@@ -0,0 +1,104 @@
+/*****************************************************************************
+//  File Name    : frame.c
+//  Description  : CRC framed binary commands for the serial control channel
+//  Target       : AVRJazz Mega328 Board, Linux host
+//
+//  No hardware access here, so the host tools build the same file.
+*****************************************************************************/
+#include "frame.h"
+
+#ifdef __AVR__
+#include <util/crc16.h>
+#endif
+
+// Receiver states
+#define RX_SOF   0
+#define RX_LEN   1
+#define RX_CMD   2
+#define RX_DATA  3
+#define RX_CRC_H 4
+#define RX_CRC_L 5
+
+uint16_t frame_crc(uint16_t crc,uint8_t b)
+{
+#ifdef __AVR__
+  return _crc_xmodem_update(crc,b);
+#else
+  uint8_t i;
+
+  crc ^= (uint16_t)b << 8;
+  for (i = 0; i < 8; i++)
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  return crc;
+#endif
+}
+
+void frame_init(frame_rx_t *f)
+{
+  f->state = RX_SOF;
+  f->errors = 0;
+}
+
+// Feed one received byte; returns 1 when f holds a complete, valid frame
+uint8_t frame_rx(frame_rx_t *f,uint8_t b)
+{
+  switch (f->state) {
+    case RX_SOF:
+      if (b == FRAME_SOF)
+        f->state = RX_LEN;
+      break;
+    case RX_LEN:
+      if (b > FRAME_MAX) {
+        f->errors++;
+        f->state = (b == FRAME_SOF) ? RX_LEN : RX_SOF;
+        break;
+      }
+      f->len = b;
+      f->pos = 0;
+      f->crc = frame_crc(0,b);
+      f->state = RX_CMD;
+      break;
+    case RX_CMD:
+      f->cmd = b;
+      f->crc = frame_crc(f->crc,b);
+      f->state = f->len ? RX_DATA : RX_CRC_H;
+      break;
+    case RX_DATA:
+      f->payload[f->pos++] = b;
+      f->crc = frame_crc(f->crc,b);
+      if (f->pos == f->len)
+        f->state = RX_CRC_H;
+      break;
+    case RX_CRC_H:
+      f->crc ^= (uint16_t)b << 8;
+      f->state = RX_CRC_L;
+      break;
+    case RX_CRC_L:
+      f->crc ^= b;
+      f->state = RX_SOF;
+      if (f->crc == 0) return 1;
+      f->errors++;
+      break;
+  }
+  return 0;
+}
+
+// Write a frame into out, which must hold len + FRAME_OVERHEAD bytes;
+// returns the frame length
+uint8_t frame_build(uint8_t *out,uint8_t cmd,const uint8_t *payload,uint8_t len)
+{
+  uint16_t crc;
+  uint8_t i;
+
+  out[0] = FRAME_SOF;
+  out[1] = len;
+  out[2] = cmd;
+  crc = frame_crc(frame_crc(0,len),cmd);
+  for (i = 0; i < len; i++) {
+    out[3 + i] = payload[i];
+    crc = frame_crc(crc,payload[i]);
+  }
+  out[3 + len] = crc >> 8;
+  out[4 + len] = crc & 0xFF;
+  return len + FRAME_OVERHEAD;
+}
@@ -0,0 +1,50 @@
+/*****************************************************************************
+//  File Name    : frame.h
+//  Description  : CRC framed binary commands for the serial control channel
+//                 and gateway sessions
+//  Target       : AVRJazz Mega328 Board, Linux host
+*****************************************************************************/
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+
+// Frame layout: FRAME_SOF, length, command, payload, CRC high, CRC low.
+// The CRC is CRC-16/XMODEM over length, command and payload.
+#define FRAME_SOF        0x7E
+#define FRAME_MAX        64        // Largest payload
+#define FRAME_OVERHEAD   5
+#define FRAME_REPLY      0x80      // Set in the command byte of replies
+
+// Commands, the same operations as the network path
+#define CMD_PING         0x01      // Echo the payload
+#define CMD_FIRE         0x02      // Send the stored code, or library code n
+#define CMD_UPLOAD       0x03      // Flags byte, then binary Pronto words
+#define CMD_STATS        0x04      // Counters, see frame_command in web_server.c
+
+// CMD_UPLOAD flags
+#define UPLOAD_FIRST     0x01      // Start a new code
+#define UPLOAD_LAST      0x02      // Code complete, finish sending it
+
+// Reply status, first payload byte
+#define STATUS_OK        0x00
+#define STATUS_BUSY      0x01
+#define STATUS_NO_CODE   0x02
+#define STATUS_BAD       0x03
+
+typedef struct {
+  uint8_t state;
+  uint8_t len;
+  uint8_t cmd;
+  uint8_t pos;
+  uint16_t crc;
+  uint16_t errors;             // Frames dropped for a bad CRC or length
+  uint8_t payload[FRAME_MAX];
+} frame_rx_t;
+
+uint16_t frame_crc(uint16_t crc,uint8_t b);
+void frame_init(frame_rx_t *f);
+uint8_t frame_rx(frame_rx_t *f,uint8_t b);
+uint8_t frame_build(uint8_t *out,uint8_t cmd,const uint8_t *payload,uint8_t len);
+
+#endif
@@ -0,0 +1,203 @@
+/*****************************************************************************
+//  File Name    : ir_emit.c
+//  Description  : Timer/Counter1 driven IR burst emitter fed from a ring
+//  Target       : AVRJazz Mega328 Board
+//
+//  Burst words are Pronto durations in carrier periods, alternating mark
+//  and space. The parser pushes words into the ring while the Timer1
+//  compare ISR pops them, so the first mark can go out while the rest of
+//  the code is still being received. Timer2 supplies the carrier for the
+//  marks, see carrier.c.
+*****************************************************************************/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "ir_emit.h"
+#include "clock.h"
+#include "carrier.h"
+
+// Pronto carrier period is freq_word * 0.241246 us. Timer1 runs at Clk/8,
+// so one carrier period is freq_word * 0.241246 * F_CPU/8e6 ticks; keep it
+// as a Q8 fixed point value so a burst becomes one multiply and shift.
+#define IR_TICK_Q16  ((uint32_t)(0.241246 * (F_CPU / 8) / 1000000.0 * 65536.0 + 0.5))
+// The slowest carrier's period, as Q8 Timer1 ticks, must fit in 16 bits
+typedef char ir_freq_check[(IR_FREQ_MAX * 241246ULL * (F_CPU / 8) * 256 <= 65535ULL * 1000000000000ULL) ? 1 : -1];
+// Idle time to wait for more data when the ring runs dry (~100 us)
+#define IR_STALL_TICKS ((uint16_t)(F_CPU / 8 / 10000))
+
+static volatile uint16_t ir_ring[IR_RING_SIZE];
+static volatile uint8_t ir_head;       // Written by ir_push()
+static volatile uint8_t ir_tail;       // Written by the ISR
+static volatile uint8_t ir_status;
+static volatile uint8_t ir_mark;       // Next word is a mark
+static volatile uint32_t ir_remain;    // Timer ticks left in this burst
+static volatile uint16_t ir_stalls;
+static volatile uint32_t ir_edge_us;
+static uint16_t ir_period_q8;
+
+// Mark or space on the LED
+static inline void ir_led(uint8_t on)
+{
+#if IR_CARRIER
+  if (on)
+    carrier_on();
+  else
+    carrier_off();
+#else
+  if (on)
+    IR_PORT |= (1<<IR_PIN);
+  else
+    IR_PORT &= ~(1<<IR_PIN);
+#endif
+}
+
+static void ir_stop(void)
+{
+  TCCR1B = 0;
+  TIMSK1 &= ~(1<<OCIE1A);
+#if IR_CARRIER
+  carrier_stop();
+#endif
+  IR_PORT &= ~(1<<IR_PIN);
+  ir_status = IR_IDLE;
+}
+
+// Load the next compare period, at most one full Timer1 cycle at a time
+static void ir_load(void)
+{
+  uint16_t chunk = (ir_remain > 0xFFFF) ? 0xFFFF : (uint16_t)ir_remain;
+
+  if (chunk < 2) chunk = 2;
+  OCR1A = chunk - 1;
+}
+
+// Pop the next burst word and drive the LED; returns 0 when the ring is empty
+static uint8_t ir_next(void)
+{
+  uint16_t burst;
+
+  if (ir_tail == ir_head) return 0;
+  burst = ir_ring[ir_tail];
+  ir_tail = (ir_tail + 1) & IR_RING_MASK;
+
+  ir_led(ir_mark);
+  ir_mark = !ir_mark;
+
+  ir_remain = ((uint32_t)burst * ir_period_q8) >> 8;
+  ir_load();
+  return 1;
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+  uint16_t done = OCR1A + 1;
+
+  if (ir_remain > done) {
+    ir_remain -= done;
+    ir_load();
+    return;
+  }
+  if (ir_next()) return;
+
+  if (ir_status == IR_DRAINING) {
+    ir_stop();
+    return;
+  }
+  // The network fell behind: hold the LED off and poll for more words
+  ir_led(0);
+  ir_stalls++;
+  ir_remain = IR_STALL_TICKS;
+  ir_load();
+}
+
+void ir_init(void)
+{
+#if IR_CARRIER
+  carrier_init();
+#endif
+  IR_DDR |= (1<<IR_PIN);
+  TCCR1A = 0;
+  ir_stop();
+  ir_edge_us = 0;
+}
+
+// Reset the ring for a new code with the given Pronto frequency word
+void ir_begin(uint16_t freq_word)
+{
+  ir_stop();
+  ir_head = 0;
+  ir_tail = 0;
+  ir_mark = 1;
+  ir_stalls = 0;
+  ir_period_q8 = ((uint32_t)freq_word * IR_TICK_Q16) >> 8;
+#if IR_CARRIER
+  carrier_start(freq_word);
+#endif
+  ir_status = IR_FILLING;
+}
+
+// Queue one burst word, waiting while the ring is full
+uint8_t ir_push(uint16_t burst)
+{
+  uint8_t next;
+
+  if (ir_status == IR_IDLE || ir_status == IR_DRAINING) return 0;
+  next = (ir_head + 1) & IR_RING_MASK;
+  while (next == ir_tail) {
+    // Ring full and nobody draining it: start now rather than deadlock
+    if (ir_status == IR_FILLING)
+      ir_start();
+  }
+  ir_ring[ir_head] = burst;
+  ir_head = next;
+  return 1;
+}
+
+void ir_start(void)
+{
+  uint8_t sreg;
+
+  if (ir_status != IR_FILLING) return;
+  sreg = SREG;
+  cli();
+  if (ir_next()) {
+    ir_edge_us = clock_us();
+    ir_status = IR_RUNNING;
+    TCNT1 = 0;
+    TIFR1 = (1<<OCF1A);
+    TIMSK1 |= (1<<OCIE1A);
+    TCCR1B = (1<<WGM12)|(1<<CS11);    // CTC Mode, Clk/8
+  }
+  SREG = sreg;
+}
+
+// No more words will follow; let the emitter finish what is queued
+void ir_end(void)
+{
+  if (ir_status == IR_FILLING)
+    ir_start();
+  if (ir_status == IR_RUNNING)
+    ir_status = IR_DRAINING;
+  else if (ir_status == IR_FILLING)
+    ir_status = IR_IDLE;
+}
+
+uint8_t ir_state(void)
+{
+  return ir_status;
+}
+
+uint8_t ir_ring_count(void)
+{
+  return (ir_head - ir_tail) & IR_RING_MASK;
+}
+
+uint16_t ir_underruns(void)
+{
+  return ir_stalls;
+}
+
+// Clock time of the first carrier edge of the last code
+uint32_t ir_first_edge_us(void)
+{
+  return ir_edge_us;
+}
@@ -0,0 +1,49 @@
+/*****************************************************************************
+//  File Name    : ir_emit.h
+//  Description  : Timer/Counter1 driven IR burst emitter fed from a ring
+//  Target       : AVRJazz Mega328 Board
+*****************************************************************************/
+#ifndef IR_EMIT_H
+#define IR_EMIT_H
+
+#include <stdint.h>
+
+// With IR_CARRIER set the LED is on OC2B (PD3) and the Timer2 carrier
+// fills the marks; with it clear PD2 carries the bare mark/space envelope
+// for an external modulator
+#define IR_CARRIER 1
+
+// IR LED output
+#define IR_PORT    PORTD
+#define IR_DDR     DDRD
+#if IR_CARRIER
+#define IR_PIN     PORTD3
+#else
+#define IR_PIN     PORTD2
+#endif
+
+// Pronto frequency words the emitter can time, from about 7.8 kHz up;
+// pronto.c rejects codes outside this range
+#define IR_FREQ_MIN    1
+#define IR_FREQ_MAX    530
+
+#define IR_RING_SIZE   32      // Burst words, must be a power of two
+#define IR_RING_MASK   (IR_RING_SIZE - 1)
+
+// Emitter states
+#define IR_IDLE        0       // Nothing to send
+#define IR_FILLING     1       // Words queued, waiting to start
+#define IR_RUNNING     2       // Timer is draining the ring
+#define IR_DRAINING    3       // Last word queued, finishing the ring
+
+void ir_init(void);
+void ir_begin(uint16_t freq_word);
+uint8_t ir_push(uint16_t burst);
+void ir_start(void);
+void ir_end(void);
+uint8_t ir_state(void);
+uint8_t ir_ring_count(void);
+uint16_t ir_underruns(void);
+uint32_t ir_first_edge_us(void);
+
+#endif
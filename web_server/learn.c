@@ -0,0 +1,238 @@
+/*****************************************************************************
+//  File Name    : learn.c
+//  Description  : IR learning: edge timestamps to a Pronto code
+//  Target       : AVRJazz Mega328 Board
+//
+//  No hardware access here: capture.c supplies the timestamps, and
+//  tools/learn_test runs the same code against the edge traces in
+//  tools/traces.
+//
+//  Timer1 is only 16 bits wide, so elapsed time is extended by polling
+//  learn_idle() at least every 32 ms while no edges arrive.
+*****************************************************************************/
+#include "learn.h"
+
+#define LEARN_PERIOD_CAP   1000000UL   // Stop averaging before the maths overflows
+
+// Cluster counts are 8 bit, so no more than LEARN_MAX durations are kept
+typedef char learn_max_check[(LEARN_MAX <= 255) ? 1 : -1];
+
+void learn_init(learn_t *l,uint16_t *dur,uint16_t max,uint8_t raw)
+{
+  l->dur = dur;
+  l->max = (max > LEARN_MAX) ? LEARN_MAX : max;
+  l->n = 0;
+  l->raw = raw;
+  l->started = 0;
+  l->mark = 0;
+  l->full = 0;
+  l->seen = 0;
+  l->idle = 0;
+  l->mark_ticks = 0;
+  l->period_sum = 0;
+  l->period_n = 0;
+}
+
+static void learn_put(learn_t *l,uint32_t ticks)
+{
+  uint32_t units = ticks >> LEARN_UNIT_SHIFT;
+
+  if (l->n >= l->max) {
+    l->full = 1;
+    return;
+  }
+  l->dur[l->n++] = (units > 0xFFFF) ? 0xFFFF : units;
+}
+
+// Average carrier period in ticks, 0 if unknown
+static uint16_t learn_period(learn_t *l)
+{
+  if (l->period_n == 0) return 0;
+  return l->period_sum / l->period_n;
+}
+
+void learn_edge(learn_t *l,uint16_t stamp)
+{
+  uint32_t d;
+  uint16_t p;
+
+  d = l->idle + (uint16_t)(stamp - l->seen);
+  l->idle = 0;
+  l->seen = stamp;
+
+  if (!l->started) {
+    l->started = 1;
+    l->mark = 1;
+    l->mark_ticks = 0;
+    return;
+  }
+
+  if (!l->raw) {
+    // Demodulated: every edge ends a mark or a space
+    learn_put(l,d);
+    l->mark = !l->mark;
+    return;
+  }
+
+  // Raw: rising edges one carrier period apart make up a mark
+  if (l->mark && d < LEARN_CARRIER_GAP) {
+    l->mark_ticks += d;
+    if (l->period_sum < LEARN_PERIOD_CAP) {
+      l->period_sum += d;
+      l->period_n++;
+    }
+    return;
+  }
+  p = learn_period(l);
+  if (l->mark)
+    learn_put(l,l->mark_ticks + p);
+  learn_put(l,(d > p) ? d - p : d);
+  l->mark = 1;
+  l->mark_ticks = 0;
+}
+
+void learn_idle(learn_t *l,uint16_t now)
+{
+  l->idle += (uint16_t)(now - l->seen);
+  l->seen = now;
+
+  // Raw: the carrier stopped, so the open mark is complete
+  if (l->raw && l->started && l->mark && l->idle >= LEARN_CARRIER_GAP) {
+    learn_put(l,l->mark_ticks + learn_period(l));
+    l->mark = 0;
+  }
+}
+
+uint8_t learn_done(learn_t *l)
+{
+  return l->full || (l->n > 0 && l->idle >= LEARN_END_TICKS);
+}
+
+// Pronto frequency word of the learned carrier
+uint16_t learn_freq(learn_t *l)
+{
+  if (!l->raw || l->period_n == 0) return LEARN_DEMOD_FREQ;
+  // Period in us is ticks / 2, Pronto word is us / 0.241246
+  return (l->period_sum * 2073UL) / (l->period_n * 1000UL);
+}
+
+static uint16_t learn_diff(uint16_t a,uint16_t b)
+{
+  return (a > b) ? a - b : b - a;
+}
+
+// Snap jittery durations to the mean of their cluster
+static void learn_cluster(learn_t *l)
+{
+  uint32_t sum[LEARN_CLUSTERS];
+  uint8_t cnt[LEARN_CLUSTERS];
+  uint16_t mean[LEARN_CLUSTERS];
+  uint8_t k,c,best;
+  uint16_t i,d;
+
+  k = 0;
+  for (i = 0; i < l->n; i++) {
+    d = l->dur[i];
+    best = LEARN_CLUSTERS;
+    for (c = 0; c < k; c++) {
+      if (learn_diff(d,mean[c]) <= mean[c] / 4 + 25) {
+        best = c;
+        break;
+      }
+    }
+    if (best == LEARN_CLUSTERS) {
+      if (k == LEARN_CLUSTERS) continue;
+      best = k++;
+      sum[best] = 0;
+      cnt[best] = 0;
+    }
+    sum[best] += d;
+    cnt[best]++;
+    mean[best] = sum[best] / cnt[best];
+  }
+
+  for (i = 0; i < l->n; i++) {
+    d = l->dur[i];
+    best = 0;
+    for (c = 1; c < k; c++) {
+      if (learn_diff(d,mean[c]) < learn_diff(d,mean[best]))
+        best = c;
+    }
+    l->dur[i] = mean[best];
+  }
+}
+
+// Length of the frame starting at from, up to and including its gap
+static uint16_t learn_frame(learn_t *l,uint16_t from)
+{
+  uint16_t i;
+
+  for (i = from + 1; i < l->n; i += 2) {
+    if (l->dur[i] >= LEARN_FRAME_GAP)
+      return i + 1 - from;
+  }
+  return l->n - from;
+}
+
+static uint8_t learn_same(learn_t *l,uint16_t a,uint16_t b,uint16_t len)
+{
+  uint16_t i;
+
+  for (i = 0; i + 1 < len; i++) {
+    if (l->dur[a + i] != l->dur[b + i]) return 0;
+  }
+  return 1;
+}
+
+static uint16_t learn_word(uint8_t *out,uint16_t pos,uint16_t w)
+{
+  out[pos++] = w >> 8;
+  out[pos++] = w & 0xFF;
+  return pos;
+}
+
+// Write the learned signal as Pronto words, big endian, like a decoded
+// POSTed code. The first frame becomes the once sequence and the second,
+// if different, the repeat sequence; a frame that simply repeats is
+// stored as a repeat sequence only. Returns the number of bytes written.
+uint16_t learn_pronto(learn_t *l,uint8_t *out,uint16_t out_max)
+{
+  uint16_t freq,len1,len2,once,start2,repeat,i,pos;
+  uint32_t periods;
+
+  if (l->n == 0) return 0;
+  // Finish on a space so the code is made of whole pairs
+  if (l->n & 1) {
+    if (l->n < l->max)
+      l->dur[l->n++] = LEARN_TAIL;
+    else
+      l->n--;
+  }
+  learn_cluster(l);
+
+  len1 = learn_frame(l,0);
+  len2 = (len1 < l->n) ? learn_frame(l,len1) : 0;
+  if (len2 == len1 && learn_same(l,0,len1,len1)) {
+    once = 0;
+    start2 = 0;
+    repeat = len1;
+  } else {
+    once = len1;
+    start2 = len1;
+    repeat = len2 & ~1;
+  }
+  if (8 + 2 * (once + repeat) > out_max) return 0;
+
+  freq = learn_freq(l);
+  pos = 0;
+  pos = learn_word(out,pos,0x0000);
+  pos = learn_word(out,pos,freq);
+  pos = learn_word(out,pos,once / 2);
+  pos = learn_word(out,pos,repeat / 2);
+  for (i = 0; i < once + repeat; i++) {
+    // Units of 2 us to carrier periods of freq * 0.241246 us
+    periods = (l->dur[(i < once) ? i : start2 + i - once] * 8290UL / freq + 500) / 1000;
+    pos = learn_word(out,pos,(periods > 0xFFFF) ? 0xFFFF : (periods ? periods : 1));
+  }
+  return pos;
+}
@@ -0,0 +1,44 @@
+/*****************************************************************************
+//  File Name    : learn.h
+//  Description  : IR learning: edge timestamps to a Pronto code
+//  Target       : AVRJazz Mega328 Board
+*****************************************************************************/
+#ifndef LEARN_H
+#define LEARN_H
+
+#include <stdint.h>
+
+// Timestamps are Timer1 ticks at Clk/8 (0.5 us); durations are kept in
+// 2 us units so a 16 bit value spans 131 ms
+#define LEARN_UNIT_SHIFT   2
+#define LEARN_MAX          128         // Recorded durations
+#define LEARN_CARRIER_GAP  200         // Ticks; longer than any carrier period
+#define LEARN_FRAME_GAP    4000        // Units (8 ms); spaces this long end a frame
+#define LEARN_TAIL         10000       // Units (20 ms); trailing space if none seen
+#define LEARN_END_TICKS    300000UL    // Ticks (150 ms) of silence end the capture
+#define LEARN_DEMOD_FREQ   0x006D      // Pronto word assumed for demodulated input (38 kHz)
+#define LEARN_CLUSTERS     16
+
+typedef struct {
+  uint16_t *dur;               // Alternating mark and space durations
+  uint16_t max;
+  uint16_t n;
+  uint8_t raw;                 // Raw carrier input instead of demodulated
+  uint8_t started;             // First edge seen
+  uint8_t mark;                // Currently inside a mark
+  uint8_t full;                // Ran out of room in dur
+  uint16_t seen;               // Tick of the last edge or poll
+  uint32_t idle;               // Ticks from the last edge to seen
+  uint32_t mark_ticks;         // Raw input: length of the open mark
+  uint32_t period_sum;         // Raw input: carrier periods seen
+  uint16_t period_n;
+} learn_t;
+
+void learn_init(learn_t *l,uint16_t *dur,uint16_t max,uint8_t raw);
+void learn_edge(learn_t *l,uint16_t stamp);
+void learn_idle(learn_t *l,uint16_t now);
+uint8_t learn_done(learn_t *l);
+uint16_t learn_freq(learn_t *l);
+uint16_t learn_pronto(learn_t *l,uint8_t *out,uint16_t out_max);
+
+#endif
@@ -0,0 +1,305 @@
+/*****************************************************************************
+//  File Name    : library.c
+//  Description  : Code library in EEPROM, loaded in bulk
+//  Target       : AVRJazz Mega328 Board
+//
+//  An upload is a stream of Pronto hex codes, one per line. Each line is
+//  decoded as it arrives and the words go into one of two page buffers;
+//  a full page is handed to the EE_READY interrupt, which programs it a
+//  byte at a time while the next page fills from the network. Bytes that
+//  already hold the right value are skipped, and a byte is only erased
+//  when one of its bits has to go from 0 to 1, so reloading a library
+//  that barely changed costs almost no EEPROM wear.
+//
+//  The index and the header are written once, after the last code. Until
+//  then the old header is left in place, and its CRC no longer matches
+//  the overwritten codes, so a power cut part way leaves an empty library
+//  rather than a corrupt one.
+*****************************************************************************/
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include "library.h"
+#include "arena.h"
+#include "pronto.h"
+#include "frame.h"
+
+#define LIB_END          (E2END + 1)
+#define LIB_OUT          32                // Decoded bytes per pronto_feed()
+#define LIB_FEED         (LIB_OUT * 2)     // Characters per pronto_feed()
+#define EE_SCAN          4                 // Bytes compared per interrupt
+
+// EEPROM programming modes, EEPM1:0
+#define EE_ERASE_WRITE   0
+#define EE_ERASE         (1<<EEPM0)
+#define EE_WRITE         (1<<EEPM1)
+
+typedef struct {
+  pronto_t pronto;
+  uint8_t out[LIB_OUT];
+  uint8_t page[2][LIB_PAGE];
+  uint8_t fill;                // Page being filled
+  uint8_t fill_len;
+  uint16_t page_addr;          // EEPROM address of the page being filled
+  uint16_t start;              // Where the current code began
+  uint16_t crc;
+  uint8_t count;
+  uint8_t bad;
+  uint16_t ends[LIB_MAX_CODES];
+  uint8_t header[LIB_HEADER_LEN];
+} upload_t;
+typedef char upload_size_check[(sizeof(upload_t) <= LIB_UPLOAD_SIZE) ? 1 : -1];
+
+static upload_t *up;
+static uint8_t lib_count;
+static uint16_t lib_end;
+
+// Page being programmed by the EE_READY interrupt
+static const uint8_t * volatile ee_src;
+static volatile uint16_t ee_addr;
+static volatile uint8_t ee_left;
+static volatile uint16_t ee_programmed,ee_unchanged;
+
+ISR(EE_READY_vect)
+{
+  uint8_t old,b,mode,scan;
+
+  // Only a few unchanged bytes are skipped per entry; the interrupt
+  // fires again at once, and the emitter's Timer1 interrupt, which has
+  // priority, never waits long behind it
+  for (scan = 0; scan < EE_SCAN && ee_left; scan++) {
+    EEAR = ee_addr;
+    EECR |= (1<<EERE);
+    old = EEDR;
+    b = *ee_src++;
+    ee_addr++;
+    ee_left--;
+    if (old == b) {
+      ee_unchanged++;
+      continue;
+    }
+    // Writing alone can only clear bits, erasing alone sets them all
+    if (b == 0xFF)
+      mode = EE_ERASE;
+    else if ((old & b) == b)
+      mode = EE_WRITE;
+    else
+      mode = EE_ERASE_WRITE;
+    EEDR = b;
+    EECR = mode | (1<<EERIE);
+    EECR |= (1<<EEMPE);
+    EECR |= (1<<EEPE);
+    ee_programmed++;
+    return;
+  }
+  if (ee_left == 0)
+    EECR &= ~(1<<EERIE);
+}
+
+static void ee_wait(void)
+{
+  while (EECR & (1<<EERIE));
+  while (EECR & (1<<EEPE));
+}
+
+// Program len bytes at addr from src, once the previous page is done
+static void ee_start(const uint8_t *src,uint16_t addr,uint8_t len)
+{
+  ee_wait();
+  ee_src = src;
+  ee_addr = addr;
+  ee_left = len;
+  EECR |= (1<<EERIE);
+}
+
+// Check the header and CRC left by the last upload
+void library_init(void)
+{
+  uint8_t header[LIB_HEADER_LEN];
+  uint16_t a,end,crc;
+
+  lib_count = 0;
+  lib_end = LIB_DATA;
+  eeprom_read_block(header,(const void *)LIB_HEADER,LIB_HEADER_LEN);
+  if (header[0] != 'O' || header[1] != 'L' || header[2] > LIB_MAX_CODES) return;
+  end = LIB_DATA;
+  if (header[2] > 0)
+    end = eeprom_read_word((const uint16_t *)(LIB_INDEX + 2 * (header[2] - 1)));
+  if (end < LIB_DATA || end > LIB_END) return;
+
+  crc = 0;
+  for (a = LIB_DATA; a < end; a++)
+    crc = frame_crc(crc,eeprom_read_byte((const uint8_t *)a));
+  for (a = LIB_INDEX; a < LIB_INDEX + 2 * header[2]; a++)
+    crc = frame_crc(crc,eeprom_read_byte((const uint8_t *)a));
+  if (crc != ((header[3] << 8) | header[4])) return;
+  lib_count = header[2];
+  lib_end = end;
+}
+
+uint8_t library_count(void)
+{
+  return lib_count;
+}
+
+// Bytes of codes stored, and room for them
+uint16_t library_used(void)
+{
+  return lib_end - LIB_DATA;
+}
+
+uint16_t library_size(void)
+{
+  return LIB_END - LIB_DATA;
+}
+
+// Copy code n to out; returns its length, or 0 if there is no such code
+uint16_t library_load(uint8_t n,uint8_t *out,uint16_t out_max)
+{
+  uint16_t start,end;
+
+  if (n >= lib_count || out == NULL) return 0;
+  start = LIB_DATA;
+  if (n > 0)
+    start = eeprom_read_word((const uint16_t *)(LIB_INDEX + 2 * (n - 1)));
+  end = eeprom_read_word((const uint16_t *)(LIB_INDEX + 2 * n));
+  if (end <= start || end - start > out_max) return 0;
+  eeprom_read_block(out,(const void *)start,end - start);
+  return end - start;
+}
+
+static void lib_flush(void)
+{
+  if (up->fill_len == 0) return;
+  ee_start(up->page[up->fill],up->page_addr,up->fill_len);
+  up->page_addr += up->fill_len;
+  up->fill ^= 1;
+  up->fill_len = 0;
+}
+
+static void lib_put(uint8_t b)
+{
+  if (up->page_addr + up->fill_len >= LIB_END) {
+    up->bad = 1;
+    return;
+  }
+  up->crc = frame_crc(up->crc,b);
+  up->page[up->fill][up->fill_len++] = b;
+  if (up->fill_len == LIB_PAGE)
+    lib_flush();
+}
+
+static void lib_drain(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < up->pronto.out_len; i++)
+    lib_put(up->out[i]);
+  up->pronto.out_len = 0;
+}
+
+static void lib_next_code(void)
+{
+  pronto_init(&up->pronto,up->out,LIB_OUT);
+  up->pronto.emit = 0;
+  up->start = up->page_addr + up->fill_len;
+}
+
+// End of a line: keep the code if it was complete
+static void lib_end_code(void)
+{
+  pronto_t *p = &up->pronto;
+  uint16_t end;
+
+  lib_drain();
+  end = up->page_addr + up->fill_len;
+  if (p->index == 0 && p->nibbles == 0) return;
+  if (p->index <= PRONTO_BURSTS || p->index < p->total || end - up->start > LIB_CODE_MAX ||
+      up->count == LIB_MAX_CODES)
+    up->bad = 1;
+  else
+    up->ends[up->count++] = end;
+  lib_next_code();
+}
+
+uint8_t library_begin(void)
+{
+  up = (upload_t *)arena_alloc(ARENA_SCRATCH,sizeof(upload_t));
+  if (up == NULL) return 0;
+  // The old codes are about to be overwritten
+  lib_count = 0;
+  lib_end = LIB_DATA;
+  up->fill = 0;
+  up->fill_len = 0;
+  up->page_addr = LIB_DATA;
+  up->crc = 0;
+  up->count = 0;
+  up->bad = 0;
+  ee_programmed = 0;
+  ee_unchanged = 0;
+  lib_next_code();
+  return 1;
+}
+
+// Take the next part of the upload; lines may be split across calls
+void library_feed(const char *s,uint16_t len)
+{
+  uint16_t n;
+
+  if (up == NULL) return;
+  while (len > 0) {
+    if (*s == '\n') {
+      lib_end_code();
+      s++;
+      len--;
+      continue;
+    }
+    for (n = 0; n < len && n < LIB_FEED && s[n] != '\n'; n++);
+    pronto_feed(&up->pronto,s,n);
+    lib_drain();
+    s += n;
+    len -= n;
+  }
+}
+
+// Finish the upload; with complete clear, or after a bad code, the index
+// is not written. Returns 1 if the new library is in place.
+uint8_t library_end(uint8_t complete)
+{
+  uint8_t ok,i;
+
+  if (up == NULL) return 0;
+  // The last line may not end in a newline
+  lib_end_code();
+  lib_flush();
+  ok = complete && !up->bad;
+  if (ok) {
+    for (i = 0; i < up->count * 2; i++)
+      up->crc = frame_crc(up->crc,((uint8_t *)up->ends)[i]);
+    up->header[0] = 'O';
+    up->header[1] = 'L';
+    up->header[2] = up->count;
+    up->header[3] = up->crc >> 8;
+    up->header[4] = up->crc & 0xFF;
+    ee_start((uint8_t *)up->ends,LIB_INDEX,up->count * 2);
+    ee_start(up->header,LIB_HEADER,LIB_HEADER_LEN);
+  }
+  ee_wait();
+  arena_free((uint8_t *)up);
+  up = NULL;
+  // On failure the old library still stands if nothing it covers changed
+  library_init();
+  return ok;
+}
+
+// EEPROM bytes programmed and skipped by the last upload
+uint16_t library_programmed(void)
+{
+  return ee_programmed;
+}
+
+uint16_t library_unchanged(void)
+{
+  return ee_unchanged;
+}
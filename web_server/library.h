@@ -0,0 +1,36 @@
+/*****************************************************************************
+//  File Name    : library.h
+//  Description  : Code library in EEPROM, loaded in bulk
+//  Target       : AVRJazz Mega328 Board
+*****************************************************************************/
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include <stdint.h>
+
+// EEPROM layout: a header, the end address of every code, then the codes
+// back to back in the same format as the stored code. The CRC in the
+// header covers the codes and the index.
+#define LIB_HEADER       0        // 'O','L', count, CRC high, CRC low
+#define LIB_HEADER_LEN   5
+#define LIB_INDEX        8        // 2 bytes per code
+#define LIB_MAX_CODES    32
+#define LIB_PAGE         32       // Write buffer; the codes start page aligned
+#define LIB_DATA         96
+#define LIB_CODE_MAX     384      // Largest code, as CODE_MAX
+#define LIB_UPLOAD_SIZE  192      // Arena bytes an upload takes while it runs
+
+void library_init(void);
+uint8_t library_count(void);
+uint16_t library_used(void);
+uint16_t library_size(void);
+uint16_t library_load(uint8_t n,uint8_t *out,uint16_t out_max);
+
+uint8_t library_begin(void);
+void library_feed(const char *s,uint16_t len);
+uint8_t library_end(uint8_t complete);
+
+uint16_t library_programmed(void);
+uint16_t library_unchanged(void);
+
+#endif
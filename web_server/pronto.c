@@ -0,0 +1,138 @@
+/*****************************************************************************
+//  File Name    : pronto.c
+//  Description  : Incremental Pronto hex decoder feeding the IR emitter
+//  Target       : AVRJazz Mega328 Board
+//
+//  Characters arrive straight from the form body as they are read off the
+//  W5100, so separators ('+', %XX escapes) are skipped here and each
+//  completed burst word is handed to the emitter right away.
+*****************************************************************************/
+#include "pronto.h"
+#include "ir_emit.h"
+
+static uint8_t hex2bin(uint8_t b) {
+  b -= '0';
+  if(b > 9) {
+    b += '0'-'A'+10;
+  }
+  if(b > 15) {
+    b += 'A'-'a';
+  }
+  return b;
+}
+
+void pronto_init(pronto_t *p,uint8_t *out,uint16_t out_max)
+{
+  p->out = out;
+  p->out_max = out_max;
+  p->out_len = 0;
+  p->word = 0;
+  p->nibbles = 0;
+  p->skip = 0;
+  p->done = 0;
+  p->index = 0;
+  p->total = PRONTO_BURSTS;
+  p->emit = 1;
+}
+
+static void pronto_word(pronto_t *p,uint16_t w)
+{
+  if (p->index >= p->total) {
+    p->done = 1;
+    return;
+  }
+  // A carrier the emitter cannot time ends the code before the bursts
+  if (p->index == PRONTO_FREQ && (w < IR_FREQ_MIN || w > IR_FREQ_MAX)) {
+    p->done = 1;
+    return;
+  }
+  if (p->out != 0 && p->out_len + 2 <= p->out_max) {
+    p->out[p->out_len++] = w >> 8;
+    p->out[p->out_len++] = w & 0xFF;
+  }
+
+  switch (p->index) {
+    case PRONTO_FORMAT:
+      break;
+    case PRONTO_FREQ:
+      if (p->emit)
+        ir_begin(w);
+      break;
+    case PRONTO_ONCE:
+    case PRONTO_REPEAT:
+      p->total += 2 * w;
+      break;
+    default:
+      if (!p->emit)
+        break;
+      ir_push(w);
+      if (IR_PIPELINE && p->index - PRONTO_BURSTS + 1 == IR_PREFILL)
+        ir_start();
+      break;
+  }
+  p->index++;
+}
+
+void pronto_feed(pronto_t *p,const char *s,uint16_t len)
+{
+  uint8_t b;
+
+  while (len-- && !p->done) {
+    if (p->skip) {
+      p->skip--;
+      s++;
+      continue;
+    }
+    if (*s == '%') {
+      p->skip = 2;
+    } else if (*s == '&' || *s == 0) {
+      p->done = 1;
+    } else {
+      b = hex2bin(*s);
+      if (b <= 15) {
+        p->word = (p->word << 4) | b;
+        if (++p->nibbles == 4) {
+          pronto_word(p,p->word);
+          p->word = 0;
+          p->nibbles = 0;
+        }
+      }
+    }
+    s++;
+  }
+}
+
+// Feed binary words, big endian, as stored by pronto_feed(); words may be
+// split across calls
+void pronto_feed_bin(pronto_t *p,const uint8_t *data,uint16_t len)
+{
+  while (len-- && !p->done) {
+    p->word = (p->word << 8) | *data++;
+    p->nibbles += 2;
+    if (p->nibbles == 4) {
+      pronto_word(p,p->word);
+      p->word = 0;
+      p->nibbles = 0;
+    }
+  }
+}
+
+// The body is complete; send whatever is still queued
+void pronto_finish(pronto_t *p)
+{
+  p->done = 1;
+  if (p->emit && p->index > PRONTO_FREQ)
+    ir_end();
+}
+
+// Send a stored code, as written to out by pronto_feed()
+void pronto_replay(const uint8_t *code,uint16_t len)
+{
+  pronto_t p;
+  uint16_t i;
+
+  pronto_init(&p,0,0);
+  for (i = 0; i + 1 < len && !p.done; i += 2)
+    pronto_word(&p,(code[i] << 8) | code[i + 1]);
+  pronto_finish(&p);
+}
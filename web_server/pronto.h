@@ -0,0 +1,42 @@
+/*****************************************************************************
+//  File Name    : pronto.h
+//  Description  : Incremental Pronto hex decoder feeding the IR emitter
+//  Target       : AVRJazz Mega328 Board
+*****************************************************************************/
+#ifndef PRONTO_H
+#define PRONTO_H
+
+#include <stdint.h>
+
+// Start the emitter as soon as IR_PREFILL burst words are queued; with
+// IR_PIPELINE set to 0 it waits until the whole code has been decoded
+#define IR_PIPELINE    1
+#define IR_PREFILL     2       // First mark/space pair
+
+// Pronto preamble word indexes
+#define PRONTO_FORMAT  0
+#define PRONTO_FREQ    1
+#define PRONTO_ONCE    2
+#define PRONTO_REPEAT  3
+#define PRONTO_BURSTS  4
+
+typedef struct {
+  uint8_t *out;            // Decoded code bytes, big endian words
+  uint16_t out_max;
+  uint16_t out_len;
+  uint16_t word;           // Word being assembled
+  uint8_t nibbles;         // Hex digits in word so far
+  uint8_t skip;            // Characters left in a %XX escape
+  uint8_t done;            // End of the form field seen
+  uint16_t index;          // Words decoded so far
+  uint16_t total;          // Words in the code, from the preamble
+  uint8_t emit;            // Drive the emitter; clear to only decode
+} pronto_t;
+
+void pronto_init(pronto_t *p,uint8_t *out,uint16_t out_max);
+void pronto_feed(pronto_t *p,const char *s,uint16_t len);
+void pronto_feed_bin(pronto_t *p,const uint8_t *data,uint16_t len);
+void pronto_finish(pronto_t *p);
+void pronto_replay(const uint8_t *code,uint16_t len);
+
+#endif
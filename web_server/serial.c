@@ -0,0 +1,107 @@
+/*****************************************************************************
+//  File Name    : serial.c
+//  Description  : Interrupt driven USART0 with RX/TX rings for the serial
+//                 control channel
+//  Target       : AVRJazz Mega328 Board
+//
+//  The ISRs only move single bytes between UDR0 and the rings; framing,
+//  CRC checks and commands all run from the main loop, so the IR emitter's
+//  Timer1 interrupt is never held off for more than a few cycles.
+*****************************************************************************/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "serial.h"
+
+// A full frame and a few bytes of whatever follows it
+typedef char serial_rx_check[(SERIAL_RX_SIZE >= FRAME_MAX + FRAME_OVERHEAD + 16) ? 1 : -1];
+
+#define SERIAL_RX_MASK   (SERIAL_RX_SIZE - 1)
+#define SERIAL_TX_MASK   (SERIAL_TX_SIZE - 1)
+// Double speed mode, UBRR = F_CPU / 8 / baud - 1
+#define SERIAL_UBRR      ((F_CPU / 8 / SERIAL_BAUD) - 1)
+
+static volatile uint8_t rx_ring[SERIAL_RX_SIZE];
+static volatile uint8_t rx_head,rx_tail;
+static volatile uint8_t tx_ring[SERIAL_TX_SIZE];
+static volatile uint8_t tx_head,tx_tail;
+static volatile uint16_t rx_overruns;
+
+ISR(USART_RX_vect)
+{
+  uint8_t status = UCSR0A;
+  uint8_t b = UDR0;
+  uint8_t next = (rx_head + 1) & SERIAL_RX_MASK;
+
+  if ((status & (1<<DOR0)) || next == rx_tail) {
+    rx_overruns++;
+    if (next == rx_tail) return;
+  }
+  rx_ring[rx_head] = b;
+  rx_head = next;
+}
+
+ISR(USART_UDRE_vect)
+{
+  if (tx_tail == tx_head) {
+    // Nothing left to send
+    UCSR0B &= ~(1<<UDRIE0);
+    return;
+  }
+  UDR0 = tx_ring[tx_tail];
+  tx_tail = (tx_tail + 1) & SERIAL_TX_MASK;
+}
+
+void serial_init(void)
+{
+  UBRR0H = SERIAL_UBRR >> 8;
+  UBRR0L = SERIAL_UBRR & 0xFF;
+  UCSR0A = (1<<U2X0);                               // Double speed
+  UCSR0C = (1<<UCSZ01)|(1<<UCSZ00);                 // 8N1
+  UCSR0B = (1<<RXEN0)|(1<<TXEN0)|(1<<RXCIE0);       // Enable Rx, Tx and Rx interrupt
+}
+
+static void serial_putc(uint8_t b)
+{
+  uint8_t next = (tx_head + 1) & SERIAL_TX_MASK;
+
+  // Wait for the UDRE interrupt to make room
+  while (next == tx_tail);
+  tx_ring[tx_head] = b;
+  tx_head = next;
+  UCSR0B |= (1<<UDRIE0);
+}
+
+// Feed waiting bytes to the framer; returns 1 when f holds a frame
+uint8_t serial_frame(frame_rx_t *f)
+{
+  uint8_t b;
+
+  while (rx_tail != rx_head) {
+    b = rx_ring[rx_tail];
+    rx_tail = (rx_tail + 1) & SERIAL_RX_MASK;
+    if (frame_rx(f,b)) return 1;
+  }
+  return 0;
+}
+
+void serial_send_frame(uint8_t cmd,const uint8_t *payload,uint8_t len)
+{
+  uint16_t crc;
+  uint8_t i;
+
+  serial_putc(FRAME_SOF);
+  serial_putc(len);
+  serial_putc(cmd);
+  crc = frame_crc(frame_crc(0,len),cmd);
+  for (i = 0; i < len; i++) {
+    serial_putc(payload[i]);
+    crc = frame_crc(crc,payload[i]);
+  }
+  serial_putc(crc >> 8);
+  serial_putc(crc & 0xFF);
+}
+
+uint16_t serial_overruns(void)
+{
+  return rx_overruns;
+}
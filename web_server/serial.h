@@ -0,0 +1,25 @@
+/*****************************************************************************
+//  File Name    : serial.h
+//  Description  : Interrupt driven USART0 with RX/TX rings for the serial
+//                 control channel
+//  Target       : AVRJazz Mega328 Board
+*****************************************************************************/
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stdint.h>
+#include "frame.h"
+
+#define SERIAL_BAUD      1000000UL  // 500000 and 1000000 are exact at 16 MHz
+// The RX ring holds a whole frame with room to spare, so a host that
+// waits for each reply before sending the next frame can never overrun
+// it, however long the main loop is away. Must be a power of two.
+#define SERIAL_RX_SIZE   128
+#define SERIAL_TX_SIZE   32         // Must be a power of two
+
+void serial_init(void);
+uint8_t serial_frame(frame_rx_t *f);
+void serial_send_frame(uint8_t cmd,const uint8_t *payload,uint8_t len);
+uint16_t serial_overruns(void);
+
+#endif
@@ -0,0 +1,78 @@
+/*****************************************************************************
+//  File Name    : session.c
+//  Description  : Gateway sessions, the serial control frames over TCP
+//  Target       : AVRJazz Mega328 Board, Linux host
+//
+//  A gateway keeps one long lived TCP connection to the device instead of
+//  connecting per request. The frames are the serial channel's, and
+//  frame_command() carries them out the same way. tools/session_test runs
+//  this file on the host against the simulated W5100.
+*****************************************************************************/
+#include <stddef.h>
+#include "session.h"
+#include "arena.h"
+#include "w5100.h"
+
+static frame_rx_t session_rx;
+
+void session_init(void)
+{
+  frame_init(&session_rx);
+}
+
+// Handle the frames waiting on the gateway session. Everything that was
+// queued when we looked is handled in this pass and the replies go back
+// together, so a batch of frames costs one segment each way.
+void session_poll(void)
+{
+  uint8_t *in,*out;
+  uint16_t left,n,i,out_len;
+  uint8_t len;
+
+  switch (w5100_status(SESSION_SOCK)) {
+    case SOCK_CLOSED:
+      frame_init(&session_rx);
+      if (w5100_socket(SESSION_SOCK,MR_TCP,SESSION_PORT) > 0)
+        w5100_listen(SESSION_SOCK);
+      return;
+    case SOCK_ESTABLISHED:
+      break;
+    case SOCK_FIN_WAIT:
+    case SOCK_CLOSING:
+    case SOCK_TIME_WAIT:
+    case SOCK_CLOSE_WAIT:
+    case SOCK_LAST_ACK:
+      w5100_close(SESSION_SOCK);
+      return;
+    default:
+      return;
+  }
+
+  left = w5100_recv_size(SESSION_SOCK);
+  if (left == 0) return;
+  in = arena_alloc(ARENA_SCRATCH,SESSION_SCRATCH);
+  if (in == NULL) return;
+  // w5100_recv() terminates what it reads, so the replies start past
+  // that byte
+  out = in + SESSION_CHUNK + 1;
+  out_len = 0;
+
+  while (left > 0) {
+    n = (left > SESSION_CHUNK) ? SESSION_CHUNK : left;
+    if (w5100_recv(SESSION_SOCK,in,n) <= 0) break;
+    left -= n;
+    for (i = 0; i < n; i++) {
+      if (!frame_rx(&session_rx,in[i])) continue;
+      len = frame_command(&session_rx);
+      out_len += frame_build(out + out_len,session_rx.cmd | FRAME_REPLY,session_rx.payload,len);
+      // Keep room for the largest reply
+      if (out_len > SESSION_OUT - (FRAME_MAX + FRAME_OVERHEAD)) {
+        w5100_send(SESSION_SOCK,out,out_len);
+        out_len = 0;
+      }
+    }
+  }
+  if (out_len > 0)
+    w5100_send(SESSION_SOCK,out,out_len);
+  arena_free(in);
+}
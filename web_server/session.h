@@ -0,0 +1,27 @@
+/*****************************************************************************
+//  File Name    : session.h
+//  Description  : Gateway sessions, the serial control frames over TCP
+//  Target       : AVRJazz Mega328 Board
+*****************************************************************************/
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stdint.h>
+#include "frame.h"
+
+#define SESSION_SOCK     3
+#define SESSION_PORT     4211
+#define SESSION_CHUNK    32       // Bytes read off the W5100 at a time
+#define SESSION_OUT      (2 * (FRAME_MAX + FRAME_OVERHEAD))  // Batched replies
+// Arena bytes session_poll() takes: the read chunk, the NUL w5100_recv()
+// puts after it, then the replies
+#define SESSION_SCRATCH  (SESSION_CHUNK + 1 + SESSION_OUT)
+
+void session_init(void);
+void session_poll(void);
+
+// Carry out one frame and leave the reply payload in f; returns its
+// length. Supplied by the application.
+uint8_t frame_command(frame_rx_t *f);
+
+#endif
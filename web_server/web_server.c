@@ -16,398 +16,766 @@
 #include <util/delay.h>
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
+#include <stdlib.h>
+#include "arena.h"
+#include "clock.h"
+#include "ir_emit.h"
+#include "pronto.h"
+#include "capture.h"
+#include "learn.h"
+#include "w5100.h"
+#include "assets.h"
+#include "serial.h"
+#include "library.h"
+#include "carrier.h"
+#include "session.h"
 
 #define byte uint8_t
 
-// AVRJazz Mega328 SPI I/O
-#define SPI_PORT PORTB
-#define SPI_DDR  DDRB
-#define SPI_CS   PORTB2
-// Wiznet W5100 Op Code
-#define WIZNET_WRITE_OPCODE 0xF0
-#define WIZNET_READ_OPCODE 0x0F
-// Wiznet W5100 Register Addresses
-#define MR         0x0000      // Mode Register
-#define GAR        0x0001      // Gateway Address: 0x0001 to 0x0004
-#define SUBR       0x0005      // Subnet mask Address: 0x0005 to 0x0008
-#define SAR        0x0009      // Source Hardware Address (MAC): 0x0009 to 0x000E
-#define SIPR       0x000F      // Source IP Address: 0x000F to 0x0012
-#define RMSR       0x001A      // RX Memory Size Register
-#define TMSR       0x001B      // TX Memory Size Register
-#define S0_MR		   0x0400      // Socket 0: Mode Register Address
-#define S0_CR		   0x0401      // Socket 0: Command Register Address
-#define S0_IR		   0x0402      // Socket 0: Interrupt Register Address
-#define S0_SR		   0x0403      // Socket 0: Status Register Address
-#define S0_PORT    0x0404      // Socket 0: Source Port: 0x0404 to 0x0405
-#define SO_TX_FSR  0x0420      // Socket 0: Tx Free Size Register: 0x0420 to 0x0421
-#define S0_TX_RD   0x0422      // Socket 0: Tx Read Pointer Register: 0x0422 to 0x0423
-#define S0_TX_WR   0x0424      // Socket 0: Tx Write Pointer Register: 0x0424 to 0x0425
-#define S0_RX_RSR  0x0426      // Socket 0: Rx Received Size Pointer Register: 0x0425 to 0x0427
-#define S0_RX_RD   0x0428      // Socket 0: Rx Read Pointer: 0x0428 to 0x0429
-#define TXBUFADDR  0x4000      // W5100 Send Buffer Base Address
-#define RXBUFADDR  0x6000      // W5100 Read Buffer Base Address
-// S0_MR values
-#define MR_CLOSE	  0x00    // Unused socket
-#define MR_TCP		  0x01    // TCP
-#define MR_UDP		  0x02    // UDP
-#define MR_IPRAW	  0x03	  // IP LAYER RAW SOCK
-#define MR_MACRAW	  0x04	  // MAC LAYER RAW SOCK
-#define MR_PPPOE	  0x05	  // PPPoE
-#define MR_ND			  0x20	  // No Delayed Ack(TCP) flag
-#define MR_MULTI	  0x80	  // support multicating
-// S0_CR values
-#define CR_OPEN          0x01	  // Initialize or open socket
-#define CR_LISTEN        0x02	  // Wait connection request in tcp mode(Server mode)
-#define CR_CONNECT       0x04	  // Send connection request in tcp mode(Client mode)
-#define CR_DISCON        0x08	  // Send closing reqeuset in tcp mode
-#define CR_CLOSE         0x10	  // Close socket
-#define CR_SEND          0x20	  // Update Tx memory pointer and send data
-#define CR_SEND_MAC      0x21	  // Send data with MAC address, so without ARP process
-#define CR_SEND_KEEP     0x22	  // Send keep alive message
-#define CR_RECV          0x40	  // Update Rx memory buffer pointer and receive data
-// S0_SR values
-#define SOCK_CLOSED      0x00     // Closed
-#define SOCK_INIT        0x13	  // Init state
-#define SOCK_LISTEN      0x14	  // Listen state
-#define SOCK_SYNSENT     0x15	  // Connection state
-#define SOCK_SYNRECV     0x16	  // Connection state
-#define SOCK_ESTABLISHED 0x17	  // Success to connect
-#define SOCK_FIN_WAIT    0x18	  // Closing state
-#define SOCK_CLOSING     0x1A	  // Closing state
-#define SOCK_TIME_WAIT	 0x1B	  // Closing state
-#define SOCK_CLOSE_WAIT  0x1C	  // Closing state
-#define SOCK_LAST_ACK    0x1D	  // Closing state
-#define SOCK_UDP         0x22	  // UDP socket
-#define SOCK_IPRAW       0x32	  // IP raw mode socket
-#define SOCK_MACRAW      0x42	  // MAC raw mode socket
-#define SOCK_PPPOE       0x5F	  // PPPOE socket
-#define TX_BUF_MASK      0x07FF   // Tx 2K Buffer Mask:
-#define RX_BUF_MASK      0x07FF   // Rx 2K Buffer Mask:
-#define NET_MEMALLOC     0x05     // Use 2K of Tx/Rx Buffer
 #define TCP_PORT         80       // TCP/IP Port
 
+// Multicast command channel
+#define MCAST_SOCK       1        // Group listener
+#define ACK_SOCK         2        // Unicast acks back to the controller
+#define MCAST_PORT       4210     // Group UDP port; acks go out from MCAST_PORT + 1
+#define DEVICE_ID        0x0001   // This box, for targeted commands
+#define DEVICE_GROUPS    0x01     // Group bits this box belongs to
+#define ACK_JITTER_MS    50       // Acks are spread over this window
+const uint8_t mcast_group[] PROGMEM = {239,255,42,1};
+
+// Multicast command header, followed by Pronto hex or nothing to send
+// the stored code:
+//   0-1  'O','R'
+//   2    flags (MC_ACK)
+//   3    group mask, a device acts if it shares any bit
+//   4-5  target device id, MC_ANY for every device in the groups
+//   6-7  sequence number; repeats are acked but not sent again
+// The ack echoes the header with MC_REPLY set, the device id in 4-5,
+// then arrival to ack in us (4 bytes) and arrival to first edge in us
+// (4). Arrival to ack covers the jitter delay and the time spent decoding
+// and queueing the code, so the controller can take it off the round trip.
+#define MC_HDR           8
+#define MC_ACK           0x01     // Ack requested
+#define MC_REPLY         0x80     // Set in acks
+#define MC_ANY           0xFFFF
+#define MC_ACK_LEN       16
+#define MC_CHUNK         16       // Code bytes read off the W5100 at a time
+
+// Ack waiting out its jitter delay; the main loop keeps running meanwhile
+typedef struct {
+  uint8_t pending;
+  uint16_t due;                // Low bits of clock_ms() to send at
+  uint32_t arrival;            // clock_us() when the command came in
+  uint8_t ip[4];               // Controller to ack
+  uint16_t port;
+  uint8_t msg[MC_ACK_LEN];
+} mc_ack_t;
+mc_ack_t mc_ack;
+
 // Define W5100 Socket Register and Variables Used
 uint8_t sockreg;
-#define MAX_BUF 1024
-uint8_t buf[MAX_BUF];
+// Arena region sizes
+#define MAX_BUF    512         // Request buffer, POST bodies are read through it
+#define CODE_MAX   384         // Largest decoded IR code
+#define TX_BUF     256         // Outgoing response chunk
+uint8_t *code_buf;
 uint16_t CODE_BUFFER_SIZE;
-
-void SPI_Write(uint16_t addr,uint8_t data)
+uint32_t edge_latency;         // Request arrival to first IR edge, in us
+
+// Request body, read off sockreg a buffer at a time into the MAX_BUF
+// request buffer
+#define BODY_WAIT_MS     2000     // Give up on a client that stops sending
+#define FIELD_SKIP       0xFF     // Inside a form field we do not want
+typedef struct {
+  char *buf;
+  uint16_t size;               // Bytes allocated, one is kept for the NUL
+  uint16_t len;                // Body bytes in buf
+  uint32_t left;               // Body bytes still on the wire
+} body_t;
+
+// Serial control channel
+frame_rx_t serial_rx;
+// One code is uploaded at a time, over serial or a session. The other
+// channel is answered busy until it is finished or UPLOAD_IDLE_MS passes
+// without a frame.
+#define UPLOAD_IDLE_MS   2000
+pronto_t upload;               // Code being uploaded
+frame_rx_t *upload_owner;      // Channel uploading it, NULL if none
+uint32_t upload_seen;          // clock_ms() of its last frame
+uint32_t upload_arrival;       // clock_us() when its first frame came in
+
+// The stored code stays in the arena between requests. The most that is
+// ever live beside it is the request and the state of a library upload;
+// a response or a session batch needs less.
+typedef char region_size_check[(ARENA_BLOCKS_FOR(MAX_BUF) + ARENA_BLOCKS_FOR(LIB_UPLOAD_SIZE) + ARENA_BLOCKS_FOR(CODE_MAX) <= ARENA_BLOCKS &&
+                                ARENA_BLOCKS_FOR(TX_BUF) + ARENA_BLOCKS_FOR(CODE_MAX) <= ARENA_BLOCKS &&
+                                ARENA_BLOCKS_FOR(SESSION_SCRATCH) + ARENA_BLOCKS_FOR(CODE_MAX) <= ARENA_BLOCKS) ? 1 : -1];
+
+// What to send back for a request
+#define ROUTE_ASSET      0        // Static file from flash
+#define ROUTE_REDIRECT   1        // 303 back to the form after an action
+#define ROUTE_STATUS     2        // Code size, arena and latency figures
+#define ROUTE_CODE       3        // Stored code as Pronto hex
+#define ROUTE_NOT_FOUND  4
+#define ROUTE_LIBRARY    5        // Library summary, after an upload too
+#define ROUTE_BAD        6        // Upload rejected
+#define ROUTE_CARRIER    7        // Carrier settings of the last code
+#define ROUTE_FAILED     8        // Nothing learned
+#define ROUTE_BUSY       9        // Emitter still sending, nothing tried
+
+// Ethernet Setup, copied out of flash by net_init()
+const w5100_net_t net_config PROGMEM = {
+  {192,168,2,1},                   // Gateway
+  {255,255,255,0},                 // Subnet mask
+  {0x00,0x16,0x36,0xDE,0x58,0xF6}, // MAC
+  {192,168,2,10},                  // IP
+};
+
+// Position of the flash string t in s, or -1
+int strindex(char *s,PGM_P t)
 {
-  // Activate the CS pin
-  SPI_PORT &= ~(1<<SPI_CS);
-  // Start Wiznet W5100 Write OpCode transmission
-  SPDR = WIZNET_WRITE_OPCODE;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));
-  // Start Wiznet W5100 Address High Bytes transmission
-  SPDR = (addr & 0xFF00) >> 8;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));
-  // Start Wiznet W5100 Address Low Bytes transmission
-  SPDR = addr & 0x00FF;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));   
-
-  // Start Data transmission
-  SPDR = data;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));
-  // CS pin is not active
-  SPI_PORT |= (1<<SPI_CS);
+  uint16_t i,n;
+
+  n=strlen_P(t);
+  for(i=0;*(s+i); i++) {
+    if (strncmp_P(s+i,t,n) == 0)
+      return i;
+  }
+  return -1;
 }
 
-unsigned char SPI_Read(uint16_t addr)
+// Reset the W5100 and program it with net_config
+uint8_t net_init(void)
 {
-  // Activate the CS pin
-  SPI_PORT &= ~(1<<SPI_CS);
-  // Start Wiznet W5100 Read OpCode transmission
-  SPDR = WIZNET_READ_OPCODE;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));
-  // Start Wiznet W5100 Address High Bytes transmission
-  SPDR = (addr & 0xFF00) >> 8;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));
-  // Start Wiznet W5100 Address Low Bytes transmission
-  SPDR = addr & 0x00FF;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));   
-
-  // Send Dummy transmission for reading the data
-  SPDR = 0x00;
-  // Wait for transmission complete
-  while(!(SPSR & (1<<SPIF)));  
-
-  // CS pin is not active
-  SPI_PORT |= (1<<SPI_CS);
-  return(SPDR);
+  w5100_net_t net;
+
+  memcpy_P(&net,&net_config,sizeof(net));
+  return w5100_init(&net);
 }
 
-void W5100_Init(void)
+// Drop the stored code
+void free_code_buf(void)
 {
-  // Ethernet Setup
-  unsigned char mac_addr[] = {0x00,0x16,0x36,0xDE,0x58,0xF6};
-  unsigned char ip_addr[] = {192,168,2,10};
-  unsigned char sub_mask[] = {255,255,255,0};
-  unsigned char gtw_addr[] = {192,168,2,1};
-  // Setting the Wiznet W5100 Mode Register: 0x0000
-  SPI_Write(MR,0x80);            // MR = 0b10000000;
-  // Setting the Wiznet W5100 Gateway Address (GAR): 0x0001 to 0x0004
-  SPI_Write(GAR + 0,gtw_addr[0]);
-  SPI_Write(GAR + 1,gtw_addr[1]);
-  SPI_Write(GAR + 2,gtw_addr[2]);
-  SPI_Write(GAR + 3,gtw_addr[3]);
-  // Setting the Wiznet W5100 Source Address Register (SAR): 0x0009 to 0x000E
-  SPI_Write(SAR + 0,mac_addr[0]);
-  SPI_Write(SAR + 1,mac_addr[1]);
-  SPI_Write(SAR + 2,mac_addr[2]);
-  SPI_Write(SAR + 3,mac_addr[3]);
-  SPI_Write(SAR + 4,mac_addr[4]);
-  SPI_Write(SAR + 5,mac_addr[5]);
-  // Setting the Wiznet W5100 Sub Mask Address (SUBR): 0x0005 to 0x0008
-  SPI_Write(SUBR + 0,sub_mask[0]);
-  SPI_Write(SUBR + 1,sub_mask[1]);
-  SPI_Write(SUBR + 2,sub_mask[2]);
-  SPI_Write(SUBR + 3,sub_mask[3]);
-  // Setting the Wiznet W5100 IP Address (SIPR): 0x000F to 0x0012
-  SPI_Write(SIPR + 0,ip_addr[0]);
-  SPI_Write(SIPR + 1,ip_addr[1]);
-  SPI_Write(SIPR + 2,ip_addr[2]);
-  SPI_Write(SIPR + 3,ip_addr[3]);    
-
-  // Setting the Wiznet W5100 RX and TX Memory Size (2KB),
-  SPI_Write(RMSR,NET_MEMALLOC);
-  SPI_Write(TMSR,NET_MEMALLOC);
+  arena_free(code_buf);
+  code_buf = NULL;
+  CODE_BUFFER_SIZE = 0;
+  // An upload in progress was writing into the old buffer
+  upload_owner = NULL;
 }
 
-void close(uint8_t sock)
+// Drop the stored code and allocate room for a new one; returns NULL if
+// the arena is full
+uint8_t *new_code_buf(void)
 {
-   if (sock != 0) return;
+  free_code_buf();
+  code_buf = arena_alloc(ARENA_CODE,CODE_MAX);
+  return code_buf;
+}
 
-   // Send Close Command
-   SPI_Write(S0_CR,CR_CLOSE);
-   // Waiting until the S0_CR is clear
-   while(SPI_Read(S0_CR));
+// Keep a decoded code as the stored code. One that never got past its
+// preamble, such as a carrier the emitter cannot time, is dropped and 0
+// returned.
+uint8_t code_keep(pronto_t *p)
+{
+  if (p->index <= PRONTO_BURSTS) {
+    free_code_buf();
+    return 0;
+  }
+  CODE_BUFFER_SIZE = p->out_len;
+  return 1;
 }
 
-void disconnect(uint8_t sock)
+// Wait for more of the request and read up to max bytes of it into buf,
+// which must hold max + 1; returns 0 if the client goes quiet for
+// BODY_WAIT_MS or closes
+uint16_t request_recv(uint8_t *buf,uint16_t max)
 {
-   if (sock != 0) return;
+  uint32_t start;
+  uint16_t n;
+
+  if (max == 0) return 0;
+  start = clock_ms();
+  while ((n = w5100_recv_size(sockreg)) == 0) {
+    if (w5100_status(sockreg) != SOCK_ESTABLISHED || clock_ms() - start > BODY_WAIT_MS)
+      return 0;
+  }
+  if (n > max)
+    n = max;
+  if (w5100_recv(sockreg,buf,n) <= 0) return 0;
+  return n;
+}
 
-   // Send Disconnect Command
-   SPI_Write(S0_CR,CR_DISCON);
-   // Wait for Disconecting Process
-   while(SPI_Read(S0_CR));
+// Read past the request headers, which may go on beyond the first read,
+// and leave the start of the body in b->buf. have is the number of bytes
+// of the request already there. Lines too long for the buffer are
+// dropped; only Content-Length is needed. Returns 0 if the headers never
+// end.
+uint8_t body_begin(body_t *b,uint16_t have)
+{
+  char *buf = b->buf;
+  uint16_t line,i,n;
+  uint8_t skip;                 // Inside a line that did not fit
+
+  b->left = 0;
+  line = 0;
+  skip = 0;
+  i = 0;
+  for (;;) {
+    for (; i < have; i++) {
+      if (buf[i] != '\n') continue;
+      if (!skip) {
+        // A blank line ends the headers
+        if (i == line || (i == line + 1 && buf[line] == '\r')) {
+          have -= i + 1;
+          memmove(buf,buf + i + 1,have + 1);
+          b->len = have;
+          b->left = (b->left > have) ? b->left - have : 0;
+          return 1;
+        }
+        if (strncasecmp_P(buf + line,PSTR("Content-Length:"),15) == 0)
+          b->left = atol(buf + line + 15);
+      }
+      skip = 0;
+      line = i + 1;
+    }
+    // Keep the unfinished line at the front and read more after it
+    if (line == 0 && have == b->size - 1) {
+      skip = 1;
+      have = 0;
+    } else {
+      have -= line;
+      memmove(buf,buf + line,have);
+    }
+    line = 0;
+    i = have;
+    n = request_recv((uint8_t *)buf + have,b->size - 1 - have);
+    if (n == 0) return 0;
+    have += n;
+  }
 }
 
-uint8_t socket(uint8_t sock,uint8_t eth_protocol,uint16_t tcp_port)
+// Next part of the body into b->buf, never more than the buffer holds;
+// returns its length, 0 once the body is done or the client stalls
+uint16_t body_read(body_t *b)
 {
-    uint8_t retval=0;
-    if (sock != 0) return retval;
+  uint16_t n = b->size - 1;
+
+  if (n > b->left)
+    n = b->left;
+  n = request_recv((uint8_t *)b->buf,n);
+  b->left -= n;
+  b->len = n;
+  return n;
+}
 
-    // Make sure we close the socket first
-    if (SPI_Read(S0_SR) == SOCK_CLOSED) {
-      close(sock);
+// Decode the code field of a POST body as it is read off the W5100, so
+// the emitter can start on the first burst pair while the rest of the
+// code is still on the wire. Returns 0 if the body has no code field or
+// the code is rejected.
+uint8_t stream_code(body_t *b)
+{
+  PGM_P field = PSTR("code=");
+  pronto_t pronto;
+  uint16_t i;
+  uint8_t match;
+
+  // The field name has to start a field, and may be split across reads
+  match = 0;
+  i = 0;
+  while (match != 5) {
+    if (i == b->len) {
+      if (body_read(b) == 0) return 0;
+      i = 0;
     }
-    // Assigned Socket 0 Mode Register
-    SPI_Write(S0_MR,eth_protocol);
-
-    // Now open the Socket 0
-    SPI_Write(S0_PORT,((tcp_port & 0xFF00) >> 8 ));
-    SPI_Write(S0_PORT + 1,(tcp_port & 0x00FF));
-    SPI_Write(S0_CR,CR_OPEN);                   // Open Socket
-    // Wait for Opening Process
-    while(SPI_Read(S0_CR));
-    // Check for Init Status
-    if (SPI_Read(S0_SR) == SOCK_INIT)
-      retval=1;
-    else
-      close(sock);
+    if (b->buf[i] == '&')
+      match = 0;
+    else if (match != FIELD_SKIP)
+      match = (b->buf[i] == pgm_read_byte(field + match)) ? match + 1 : FIELD_SKIP;
+    i++;
+  }
 
-    return retval;
+  pronto_init(&pronto,new_code_buf(),CODE_MAX);
+  pronto_feed(&pronto,b->buf + i,b->len - i);
+  while (!pronto.done && body_read(b) > 0)
+    pronto_feed(&pronto,b->buf,b->len);
+  pronto_finish(&pronto);
+  return code_keep(&pronto);
 }
 
-uint8_t listen(uint8_t sock)
+// Store the body of POST /library, one Pronto hex code per line, as the
+// code library in EEPROM. Like stream_code() the body is pulled off the
+// W5100 as it arrives, so a library is not limited to MAX_BUF. Without a
+// Content-Length what came with the headers is taken as the whole body.
+uint8_t library_upload(body_t *b)
 {
-   uint8_t retval = 0;
-   if (sock != 0) return retval;
-   if (SPI_Read(S0_SR) == SOCK_INIT) {
-     // Send the LISTEN Command
-     SPI_Write(S0_CR,CR_LISTEN);
-
-     // Wait for Listening Process
-     while(SPI_Read(S0_CR));
-     // Check for Listen Status
-     if (SPI_Read(S0_SR) == SOCK_LISTEN)
-       retval=1;
-     else
-       close(sock);
-    }
-    return retval;
+  if (!library_begin()) return 0;
+  do
+    library_feed(b->buf,b->len);
+  while (b->left > 0 && body_read(b) > 0);
+  return library_end(b->left == 0);
 }
 
-uint16_t send_pack(uint8_t sock,const uint8_t *buf,uint16_t buflen)
+// Make library code n the stored code; returns 0 if there is no such code
+uint8_t library_select(uint8_t n)
 {
-   uint16_t ptr,offaddr,realaddr,txsize,timeout;   
-
-   if (buflen <= 0 || sock != 0) return 0;
-
-   // Make sure the TX Free Size Register is available
-   txsize=SPI_Read(SO_TX_FSR);
-   txsize=(((txsize & 0x00FF) << 8 ) + SPI_Read(SO_TX_FSR + 1));
-
-   timeout=0;
-   while (txsize < buflen) {
-      _delay_ms(1);
-     txsize=SPI_Read(SO_TX_FSR);
-     txsize=(((txsize & 0x00FF) << 8 ) + SPI_Read(SO_TX_FSR + 1));
-
-     // Timeout for approx 5000 ms
-     if (timeout++ > 5000) {
-       // Disconnect the connection
-       disconnect(sock);
-       return 0;
-     }
-   }	
-
-   // Read the Tx Write Pointer
-   ptr = SPI_Read(S0_TX_WR);
-   offaddr = (((ptr & 0x00FF) << 8 ) + SPI_Read(S0_TX_WR + 1));
-
-   while(buflen) {
-     buflen--;
-     // Calculate the real W5100 physical Tx Buffer Address
-     realaddr = TXBUFADDR + (offaddr & TX_BUF_MASK);
-     // Copy the application data to the W5100 Tx Buffer
-     SPI_Write(realaddr,*buf);
-     offaddr++;
-     buf++;
-   }
-
-   // Increase the S0_TX_WR value, so it point to the next transmit
-   SPI_Write(S0_TX_WR,(offaddr & 0xFF00) >> 8 );
-   SPI_Write(S0_TX_WR + 1,(offaddr & 0x00FF));	
-
-   // Now Send the SEND command
-   SPI_Write(S0_CR,CR_SEND);
-
-   // Wait for Sending Process
-   while(SPI_Read(S0_CR));	
-
-   return 1;
+  if (new_code_buf() == NULL) return 0;
+  CODE_BUFFER_SIZE = library_load(n,code_buf,CODE_MAX);
+  return CODE_BUFFER_SIZE > 0;
 }
 
-uint16_t recv(uint8_t sock,uint8_t *buf,uint16_t buflen)
+// Record a code from the IR receiver on ICP1 and keep it as the stored
+// code. Waits up to LEARN_WAIT_MS for the first edge. The emitter must be
+// idle, since capture takes over Timer1, and the request buffer must
+// already be free: the old code is dropped as well, so the capture ring
+// and the durations have the arena to themselves. Returns 0 if nothing
+// was learned or an edge was lost.
+#define LEARN_WAIT_MS 5000
+typedef char learn_size_check[(ARENA_BLOCKS_FOR(CAPTURE_SIZE * 2) + ARENA_BLOCKS_FOR(LEARN_MAX * 2) <= ARENA_BLOCKS &&
+                               ARENA_BLOCKS_FOR(LEARN_MAX * 2) + ARENA_BLOCKS_FOR(CODE_MAX) <= ARENA_BLOCKS) ? 1 : -1];
+uint8_t learn_code(uint8_t raw)
 {
-    uint16_t ptr,offaddr,realaddr;   	
-
-    if (buflen <= 0 || sock != 0) return 1;   
-
-    // If the request size > MAX_BUF,just truncate it
-    if (buflen > MAX_BUF - 1)
-      buflen=MAX_BUF - 2;
-    // Read the Rx Read Pointer
-    ptr = SPI_Read(S0_RX_RD);
-    offaddr = (((ptr & 0x00FF) << 8 ) + SPI_Read(S0_RX_RD + 1));
-
-    while(buflen) {
-      buflen--;
-      realaddr=RXBUFADDR + (offaddr & RX_BUF_MASK);
-      *buf = SPI_Read(realaddr);
-      offaddr++;
-      buf++;
+  learn_t learn;
+  uint16_t *ring,*dur;
+  uint16_t stamp,now;
+  uint32_t start;
+  uint8_t ok;
+
+  if (ir_state() != IR_IDLE) return 0;
+  free_code_buf();
+  // The ring goes last, so the code can take its blocks afterwards
+  dur = (uint16_t *)arena_alloc(ARENA_SCRATCH,LEARN_MAX * 2);
+  ring = (uint16_t *)arena_alloc(ARENA_SCRATCH,CAPTURE_SIZE * 2);
+  if (ring == NULL || dur == NULL) {
+    arena_release(ARENA_SCRATCH);
+    return 0;
+  }
+
+  learn_init(&learn,dur,LEARN_MAX,raw);
+  capture_start(ring,raw);
+  start = clock_ms();
+  while (!learn_done(&learn)) {
+    now = capture_now();
+    if (capture_read(&stamp))
+      learn_edge(&learn,stamp);
+    else
+      learn_idle(&learn,now);
+    if (!learn.started && clock_ms() - start > LEARN_WAIT_MS) break;
+  }
+  capture_stop();
+  // Hand Timer1 back to the emitter
+  ir_init();
+  // The ring is done with; the code goes in its place
+  arena_free((uint8_t *)ring);
+
+  ok = learn.n > 0 && capture_lost() == 0;
+  if (ok && new_code_buf() != NULL)
+    CODE_BUFFER_SIZE = learn_pronto(&learn,code_buf,CODE_MAX);
+  arena_release(ARENA_SCRATCH);
+  return ok && CODE_BUFFER_SIZE > 0;
+}
+
+// Send the stored code as Pronto hex, a TX_BUF chunk at a time
+uint16_t send_code_hex(uint8_t sock,uint8_t *tx_buf)
+{
+  uint16_t i,len;
+
+  len = 0;
+  for (i = 0; i + 1 < CODE_BUFFER_SIZE; i += 2) {
+    sprintf_P((char *)tx_buf + len, PSTR("%02X%02X "), code_buf[i], code_buf[i + 1]);
+    len += 5;
+    if (len + 5 >= TX_BUF) {
+      if (w5100_send(sock, tx_buf, len) <= 0) return 0;
+      len = 0;
     }
-    *buf='\0';        // String terminated character
+  }
+  if (len > 0)
+    return w5100_send(sock, tx_buf, len);
+  return 1;
+}
 
-    // Increase the S0_RX_RD value, so it point to the next receive
-    SPI_Write(S0_RX_RD,(offaddr & 0xFF00) >> 8 );
-    SPI_Write(S0_RX_RD + 1,(offaddr & 0x00FF));	
+// Join the multicast group on MCAST_SOCK and open the ack socket
+void mcast_open(void)
+{
+  // Sn_DHAR, Sn_DIPR and Sn_DPORT are adjacent, so program them as one
+  // block; the group MAC is 01:00:5E plus the low 23 bits of the address
+  uint8_t dest[12];
+
+  memcpy_P(dest + 6,mcast_group,4);
+  dest[0] = 0x01;
+  dest[1] = 0x00;
+  dest[2] = 0x5E;
+  dest[3] = dest[7] & 0x7F;
+  dest[4] = dest[8];
+  dest[5] = dest[9];
+  dest[10] = MCAST_PORT >> 8;
+  dest[11] = MCAST_PORT & 0xFF;
+
+  w5100_write_block(SOCK_BASE(MCAST_SOCK) + Sn_DHAR,dest,sizeof(dest));
+  // The W5100 sends the IGMP join when the socket opens
+  w5100_socket(MCAST_SOCK,MR_UDP | MR_MULTI,MCAST_PORT);
+
+  if (w5100_status(ACK_SOCK) != SOCK_UDP)
+    w5100_socket(ACK_SOCK,MR_UDP,MCAST_PORT + 1);
+}
 
-    // Now Send the RECV command
-    SPI_Write(S0_CR,CR_RECV);
-    _delay_us(5);    // Wait for Receive Process
+// Throw away the rest of a datagram
+void mcast_skip(uint16_t len)
+{
+  uint8_t chunk[MC_CHUNK + 1];
+  uint16_t n;
 
-    return 1;
+  while (len) {
+    n = (len > MC_CHUNK) ? MC_CHUNK : len;
+    w5100_recv(MCAST_SOCK,chunk,n);
+    len -= n;
+  }
 }
 
-uint16_t recv_size(void)
+// Send the waiting ack, stamped with the time since its command arrived
+void mcast_ack_send(void)
 {
-  return ((SPI_Read(S0_RX_RSR) & 0x00FF) << 8 ) + SPI_Read(S0_RX_RSR + 1);
+  uint32_t hold;
+
+  if (!mc_ack.pending) return;
+  mc_ack.pending = 0;
+  hold = clock_us() - mc_ack.arrival;
+  mc_ack.msg[8] = hold >> 24;
+  mc_ack.msg[9] = hold >> 16;
+  mc_ack.msg[10] = hold >> 8;
+  mc_ack.msg[11] = hold & 0xFF;
+  w5100_sendto(ACK_SOCK,mc_ack.msg,MC_ACK_LEN,mc_ack.ip,mc_ack.port);
 }
 
-int strindex(char *s,char *t)
+// Handle one group command if a datagram is waiting
+void mcast_poll(void)
 {
-  uint16_t i,n;
+  static uint16_t last_seq;
+  static uint8_t have_seq;
+  uint8_t udp[9],cmd[MC_HDR + 1],chunk[MC_CHUNK + 1];
+  uint16_t len,n,target,seq;
+  uint32_t arrival,latency;
+  uint8_t accept;
+  pronto_t pronto;
+
+  if (w5100_status(MCAST_SOCK) != SOCK_UDP) {
+    mcast_open();
+    return;
+  }
+  if (w5100_recv_size(MCAST_SOCK) < 8) return;
+  arrival = clock_us();
+
+  // W5100 UDP header: source IP, source port, data length
+  w5100_recv(MCAST_SOCK,udp,8);
+  len = (udp[6] << 8) | udp[7];
+  if (len < MC_HDR || len > 2048) {
+    mcast_skip(len & 0x07FF);
+    return;
+  }
+  w5100_recv(MCAST_SOCK,cmd,MC_HDR);
+  len -= MC_HDR;
+
+  target = (cmd[4] << 8) | cmd[5];
+  seq = (cmd[6] << 8) | cmd[7];
+  accept = cmd[0] == 'O' && cmd[1] == 'R' && !(cmd[2] & MC_REPLY) &&
+           (target == DEVICE_ID || (target == MC_ANY && (cmd[3] & DEVICE_GROUPS)));
+  if (!accept) {
+    mcast_skip(len);
+    return;
+  }
 
-  n=strlen(t);
-  for(i=0;*(s+i); i++) {
-    if (strncmp(s+i,t,n) == 0)
-      return i;
+  latency = 0;
+  if (have_seq && seq == last_seq) {
+    mcast_skip(len);
+  } else {
+    have_seq = 1;
+    last_seq = seq;
+    if (len > 0) {
+      // Stream the code straight into the emitter, as for a POST
+      pronto_init(&pronto,new_code_buf(),CODE_MAX);
+      while (len) {
+        n = (len > MC_CHUNK) ? MC_CHUNK : len;
+        w5100_recv(MCAST_SOCK,chunk,n);
+        pronto_feed(&pronto,(char *)chunk,n);
+        len -= n;
+      }
+      pronto_finish(&pronto);
+      code_keep(&pronto);
+    } else if (code_buf != NULL) {
+      pronto_replay(code_buf,CODE_BUFFER_SIZE);
+    }
+    if (ir_first_edge_us() >= arrival)
+      latency = ir_first_edge_us() - arrival;
   }
-  return -1;
+
+  if (!(cmd[2] & MC_ACK)) return;
+  // Only one ack waits at a time; an older one goes out now
+  mcast_ack_send();
+  // Spread acks so a whole fleet does not answer in the same instant
+  mc_ack.due = clock_ms() + (DEVICE_ID * 37 + seq * 11) % ACK_JITTER_MS;
+  mc_ack.arrival = arrival;
+  memcpy(mc_ack.ip,udp,4);
+  mc_ack.port = (udp[4] << 8) | udp[5];
+  memcpy(mc_ack.msg,cmd,MC_HDR);
+  mc_ack.msg[2] |= MC_REPLY;
+  mc_ack.msg[4] = DEVICE_ID >> 8;
+  mc_ack.msg[5] = DEVICE_ID & 0xFF;
+  mc_ack.msg[12] = latency >> 24;
+  mc_ack.msg[13] = latency >> 16;
+  mc_ack.msg[14] = latency >> 8;
+  mc_ack.msg[15] = latency & 0xFF;
+  mc_ack.pending = 1;
 }
 
-char* post_value(char* field, char* header)
+// Send the waiting ack once its jitter delay is up
+void mcast_ack_poll(void)
 {
-	char* ch_ptr;
-	char* old;
-	
-	old = NULL;
-
-	ch_ptr = strtok(header, "\n");
-	while(ch_ptr != NULL)
-	{
-		old = ch_ptr;
-		ch_ptr = strtok(NULL, "\n");
-	}
-
-	old += strlen(field) + 1;
-	return old;
+  if (mc_ack.pending && (int16_t)((uint16_t)clock_ms() - mc_ack.due) >= 0)
+    mcast_ack_send();
 }
 
-uint8_t hex2bin(uint8_t b) {
-  b -= '0';
-  if(b > 9) {
-    b += '0'-'A'+10;
+// Carry out one framed command, from the serial channel or a gateway
+// session. The reply payload is written over the request payload, with
+// the status byte first; returns its length.
+uint8_t frame_command(frame_rx_t *f)
+{
+  uint8_t *p = f->payload;
+  uint8_t status,flags;
+  uint32_t arrival;
+
+  arrival = clock_us();
+  status = STATUS_OK;
+  switch (f->cmd) {
+    case CMD_PING:
+      return f->len;
+    case CMD_FIRE:
+      // With a payload, the first byte picks a code from the library
+      if (ir_state() != IR_IDLE)
+        status = STATUS_BUSY;
+      else if (f->len > 0 && !library_select(p[0]))
+        status = STATUS_NO_CODE;
+      else if (code_buf == NULL || CODE_BUFFER_SIZE == 0)
+        status = STATUS_NO_CODE;
+      else
+        pronto_replay(code_buf, CODE_BUFFER_SIZE);
+      break;
+    case CMD_UPLOAD:
+      if (f->len == 0) {
+        status = STATUS_BAD;
+        break;
+      }
+      flags = p[0];
+      if (upload_owner != NULL && upload_owner != f && clock_ms() - upload_seen < UPLOAD_IDLE_MS) {
+        status = STATUS_BUSY;
+        break;
+      }
+      if (flags & UPLOAD_FIRST) {
+        // Starting a code cuts off the one still being sent
+        if (ir_state() != IR_IDLE) {
+          status = STATUS_BUSY;
+          break;
+        }
+        pronto_init(&upload, new_code_buf(), CODE_MAX);
+        upload_owner = f;
+        upload_arrival = arrival;
+      }
+      if (upload_owner != f) {
+        status = STATUS_BAD;
+        break;
+      }
+      upload_seen = clock_ms();
+      // Words go straight to the emitter, as for a POST
+      pronto_feed_bin(&upload, p + 1, f->len - 1);
+      if (flags & UPLOAD_LAST) {
+        pronto_finish(&upload);
+        upload_owner = NULL;
+        // Timed from the first frame: the first edge of a longer code
+        // went out while an earlier frame was handled
+        if (!code_keep(&upload))
+          status = STATUS_BAD;
+        else if (ir_first_edge_us() >= upload_arrival)
+          edge_latency = ir_first_edge_us() - upload_arrival;
+      }
+      break;
+    case CMD_STATS:
+      p[0] = STATUS_OK;
+      p[1] = CODE_BUFFER_SIZE >> 8;
+      p[2] = CODE_BUFFER_SIZE & 0xFF;
+      p[3] = arena_high_water() >> 8;
+      p[4] = arena_high_water() & 0xFF;
+      p[5] = edge_latency >> 24;
+      p[6] = edge_latency >> 16;
+      p[7] = edge_latency >> 8;
+      p[8] = edge_latency & 0xFF;
+      p[9] = ir_underruns() >> 8;
+      p[10] = ir_underruns() & 0xFF;
+      p[11] = f->errors >> 8;
+      p[12] = f->errors & 0xFF;
+      p[13] = serial_overruns() >> 8;
+      p[14] = serial_overruns() & 0xFF;
+      return 15;
+    default:
+      status = STATUS_BAD;
+      break;
   }
-  if(b > 15) {
-    b += 'A'-'a';
+  p[0] = status;
+  return 1;
+}
+
+// Handle one framed command from the serial control channel
+void serial_poll(void)
+{
+  uint8_t len;
+
+  if (!serial_frame(&serial_rx)) return;
+  len = frame_command(&serial_rx);
+  serial_send_frame(serial_rx.cmd | FRAME_REPLY, serial_rx.payload, len);
+}
+
+// Value of the request header name, which includes the colon, or NULL.
+// Header names are matched at the start of a line, in any case.
+char *header_find(char *req,PGM_P name)
+{
+  char *p;
+  uint16_t n;
+
+  n = strlen_P(name);
+  for (p = req; *p; p++) {
+    if ((p == req || p[-1] == '\n') && strncasecmp_P(p,name,n) == 0)
+      return p + n;
   }
-  return b;
+  return NULL;
 }
 
-void convert_code(char* code) {
-  //byte* end = CODE_BUFFER + CODE_BUFFER_SIZE;
-  byte* end = buf + MAX_BUF;
-  byte* ptr = buf;
-  byte high = 1;
-  
-  while(*code != 0 && ptr != end) {
-    uint8_t b = hex2bin(*code);
-    if(0 <= b && b <= 15) {
-      if(high) {
-        *ptr = b;
-        *ptr <<= 4;
-        high = !high;
-      } else {
-        *ptr += b;
-        ptr++;
-        high = !high;
-      }
+// True if the value of header name contains the flash string s
+uint8_t header_has(char *req,PGM_P name,PGM_P s)
+{
+  char *p,*end,save;
+  uint8_t found;
+
+  p = header_find(req,name);
+  if (p == NULL) return 0;
+  for (end = p; *end && *end != '\r' && *end != '\n'; end++);
+  save = *end;
+  *end = 0;
+  found = strstr_P(p,s) != NULL;
+  *end = save;
+  return found;
+}
+
+// True if If-None-Match lists etag or is "*". Each entity tag is
+// compared whole, between its quotes, so a client holding "55be15d1-gz"
+// does not match the plain "55be15d1". A weak W/ prefix is ignored, as
+// it may be for a GET.
+uint8_t etag_match(char *req,const char *etag)
+{
+  char *p;
+  uint8_t n;
+
+  p = header_find(req,PSTR("If-None-Match:"));
+  if (p == NULL) return 0;
+  n = strlen(etag);
+  while (*p && *p != '\r' && *p != '\n') {
+    if (*p == '*') return 1;
+    if (p[0] == 'W' && p[1] == '/')
+      p += 2;
+    if (*p != '"') {
+      p++;
+      continue;
     }
-    code++;
+    if (strncmp(p + 1,etag,n) == 0 && p[n + 1] == '"') return 1;
+    // Past the closing quote of a tag that is not ours
+    for (p++; *p && *p != '"' && *p != '\r' && *p != '\n'; p++);
+    if (*p == '"')
+      p++;
+  }
+  return 0;
+}
+
+// True if the request path is p, ignoring any query string
+uint8_t path_is(const char *path,PGM_P p)
+{
+  uint16_t n = strlen_P(p);
+
+  return strncmp_P(path,p,n) == 0 &&
+         (path[n] == ' ' || path[n] == '?' || path[n] == 0);
+}
+
+// Copy the asset served at path into a, returns 0 if there is none
+uint8_t find_asset(const char *path,asset_t *a)
+{
+  uint8_t i;
+
+  for (i = 0; i < ASSET_COUNT; i++) {
+    memcpy_P(a,&assets[i],sizeof(asset_t));
+    if (path_is(path,a->path)) return 1;
   }
+  return 0;
+}
 
-  CODE_BUFFER_SIZE = ptr - buf;
+// Start a response: status line, then Content-Type if type is given.
+// The caller appends any other headers and the blank line.
+void http_header(uint8_t *tx_buf,PGM_P status,PGM_P type)
+{
+  strcpy_P((char *)tx_buf, PSTR("HTTP/1.0 "));
+  strcat_P((char *)tx_buf, status);
+  strcat_P((char *)tx_buf, PSTR("\r\n"));
+  if (type != NULL) {
+    strcat_P((char *)tx_buf, PSTR("Content-Type: "));
+    strcat_P((char *)tx_buf, type);
+    strcat_P((char *)tx_buf, PSTR("\r\n"));
+  }
+}
+
+// Send a static asset from flash, or 304 if the client already has it
+uint16_t send_asset(uint8_t sock,uint8_t *tx_buf,asset_t *a,uint8_t gzip,uint8_t not_modified)
+{
+  const uint8_t *data = gzip ? a->gz : a->raw;
+  uint16_t len = gzip ? a->gz_len : a->raw_len;
+  uint16_t n;
+
+  if (not_modified)
+    http_header(tx_buf, PSTR("304 Not Modified"), NULL);
+  else
+    http_header(tx_buf, PSTR("200 OK"), a->type);
+  strcat_P((char *)tx_buf, PSTR("ETag: \""));
+  strcat_P((char *)tx_buf, a->etag);
+  if (gzip)
+    strcat_P((char *)tx_buf, PSTR("-gz"));
+  strcat_P((char *)tx_buf, PSTR("\"\r\nVary: Accept-Encoding\r\n"));
+  if (a->flags & ASSET_LONG_CACHE)
+    strcat_P((char *)tx_buf, PSTR("Cache-Control: max-age=86400\r\n"));
+  else
+    strcat_P((char *)tx_buf, PSTR("Cache-Control: no-cache\r\n"));
+  if (not_modified) {
+    strcat_P((char *)tx_buf, PSTR("\r\n"));
+    return w5100_send(sock, tx_buf, strlen((char *)tx_buf));
+  }
+  if (gzip)
+    strcat_P((char *)tx_buf, PSTR("Content-Encoding: gzip\r\n"));
+  sprintf_P((char *)tx_buf+strlen((char *)tx_buf), PSTR("Content-Length: %u\r\n\r\n"), len);
+  if (w5100_send(sock, tx_buf, strlen((char *)tx_buf)) <= 0) return 0;
+
+  while (len) {
+    n = (len > TX_BUF) ? TX_BUF : len;
+    memcpy_P(tx_buf, data, n);
+    if (w5100_send(sock, tx_buf, n) <= 0) return 0;
+    data += n;
+    len -= n;
+  }
+  return 1;
 }
 
 int main(void){
   uint8_t sockstat;
   uint16_t rsize;
-  char* code;
+  uint8_t *rx_buf,*tx_buf;
+  uint32_t arrival;
   int getidx,postidx;
-  int is_favicon;
+  char *path;
+  char etag[16];
+  asset_t asset;
+  body_t body;
+  uint8_t route,gzip,not_modified,raw,lib;
 
   // Reset Port D
   DDRD = 0xFF;       // Set PORTD as Output
@@ -418,76 +786,194 @@ int main(void){
   // Free running ADC Mode
   ADCSRB = 0x00;
   // Initial the AVR ATMega328 SPI Peripheral
-  // Set MOSI (PORTB3),SCK (PORTB5) and PORTB2 (SS) as output, others as input
-  SPI_DDR = (1<<PORTB3)|(1<<PORTB5)|(1<<PORTB2);
-  // CS pin is not active
-  SPI_PORT |= (1<<SPI_CS);
-  // Enable SPI, Master Mode 0, set the clock rate fck/2
-  SPCR = (1<<SPE)|(1<<MSTR);
-  SPSR |= (1<<SPI2X);  
-
-  // Initial ATMega368 Timer/Counter0 Peripheral
-  TCCR0A=0x00;                  // Normal Timer0 Operation
-  TCCR0B=(1<<CS02)|(1<<CS00);   // Use maximum prescaller: Clk/1024
-  TCNT0=0x94;                   // Start counter from 0x94, overflow at 10 mSec
-  TIMSK0=(1<<TOIE0);            // Enable Counter Overflow Interrupt
+  w5100_spi_init();
+
+  // Initial the USART0 serial control channel
+  serial_init();
+  frame_init(&serial_rx);
+  session_init();
+  upload_owner=NULL;
+
+  // Initial ATMega368 Timer/Counter0 as a 1 mSec clock
+  clock_init();
+  // Initial the Timer/Counter1 IR emitter
+  ir_init();
   sei();                        // Enable Interrupt
 
   // Initial the W5100 Ethernet
-  W5100_Init();
+  net_init();
   // Initial variable used
   sockreg=0;
+  arena_init();
+  code_buf=NULL;
+  // Check the code library left in EEPROM
+  library_init();
 
   // Loop forever
   for(;;){
-    sockstat=SPI_Read(S0_SR);
+    // Group, serial and session commands are checked between every step
+    // of the web server
+    mcast_poll();
+    mcast_ack_poll();
+    serial_poll();
+    session_poll();
+    sockstat=w5100_status(sockreg);
     switch(sockstat) {
      case SOCK_CLOSED:
-        if (socket(sockreg,MR_TCP,TCP_PORT) > 0) {
+        if (w5100_socket(sockreg,MR_TCP,TCP_PORT) > 0) {
           // Listen to Socket 0
-          if (listen(sockreg) <= 0)
+          if (w5100_listen(sockreg) <= 0)
             _delay_ms(1);
         }
         break;
      case SOCK_ESTABLISHED:
         // Get the client request size
-        rsize=recv_size();
+        rsize=w5100_recv_size(sockreg);
         if (rsize > 0)
         {
-          // Now read the client Request
-          if (recv(sockreg,buf,rsize) <= 0) break;
+          arrival=clock_us();
+          // Now read the client Request; the whole buffer is taken, as a
+          // POST body is read through it after the first part
+          if (rsize > MAX_BUF - 1)
+            rsize=MAX_BUF - 1;
+          rx_buf=arena_alloc(ARENA_RX,MAX_BUF);
+          if (rx_buf == NULL) break;
+          if (w5100_recv(sockreg,rx_buf,rsize) <= 0) {
+            arena_free(rx_buf);
+            break;
+          }
           // Check the Request Header
-          getidx=strindex((char *)buf,"GET /");
-          postidx=strindex((char *)buf,"POST /");
-          
-          is_favicon = strindex((char *)buf, "favicon");
+          getidx=strindex((char *)rx_buf,PSTR("GET /"));
+          postidx=strindex((char *)rx_buf,PSTR("POST /"));
           
-          if ((getidx >= 0 || postidx >= 0) && is_favicon < 0)
+          if (getidx >= 0 || postidx >= 0)
           {            
-            char field[] = "code";
-            code = post_value(field, (char *)buf);
-            
-            convert_code(code);
-            
-            
-            // Create the HTTP Response Header
-            strcpy_P((char *)buf, PSTR("HTTP/1.0 200 OK\r\nContent-Type: text/html\r\n\r\n"));
-            strcat_P((char *)buf, PSTR("<html><body><span style=\"color:#0000A0\">\r\n"));
-            strcat_P((char *)buf, PSTR("<h1>OpenRemote</h1>\r\n"));
-            strcat_P((char *)buf, PSTR("<h3>Please Enter Pronto Code Below:</h3>\r\n"));
-            strcat_P((char *)buf, PSTR("<p><form method=\"POST\">\r\n"));
-            // Now Send the HTTP Response
-            if (send_pack(sockreg, buf, strlen((char *)buf)) <= 0) break;
-            
-            strcpy_P((char *)buf, PSTR("Code: <textarea name=\"code\" rows=\"5\" cols=\"30\"></textarea><br />\r\n"));
-            strcat_P((char *)buf, PSTR("<input type=\"submit\">\r\n</form>"));
-            sprintf((char *)buf+strlen((char *)buf), "%u", CODE_BUFFER_SIZE);
-            strcat_P((char *)buf, PSTR("</p></span></body></html>\r\n"));
-            // Now Send the HTTP Remaining Response
-            if (send_pack(sockreg, buf, strlen((char *)buf)) <= 0) break;
+            path = (char *)rx_buf + ((getidx >= 0) ? getidx + 4 : postidx + 5);
+            gzip = header_has((char *)rx_buf, PSTR("Accept-Encoding:"), PSTR("gzip"));
+            not_modified = 0;
+
+            if (postidx >= 0) {
+              // The path goes when body_begin() moves the body down
+              lib = path_is(path, PSTR("/library"));
+              body.buf = (char *)rx_buf;
+              body.size = MAX_BUF;
+              route = ROUTE_BAD;
+              if (body_begin(&body,rsize)) {
+                if (lib) {
+                  if (library_upload(&body))
+                    route = ROUTE_LIBRARY;
+                } else if (stream_code(&body)) {
+                  if (ir_first_edge_us() >= arrival)
+                    edge_latency=ir_first_edge_us() - arrival;
+                  route = ROUTE_REDIRECT;
+                }
+              }
+            } else if (path_is(path, PSTR("/learn"))) {
+              raw = strncmp_P(path, PSTR("/learn?raw"), 10) == 0;
+              if (ir_state() != IR_IDLE) {
+                // Timer1 is still sending a code
+                route = ROUTE_BUSY;
+              } else {
+                // Learning needs the blocks the request is holding
+                arena_free(rx_buf);
+                rx_buf=NULL;
+                route = learn_code(raw) ? ROUTE_REDIRECT : ROUTE_FAILED;
+              }
+            } else if (path_is(path, PSTR("/library"))) {
+              route = ROUTE_LIBRARY;
+            } else if (strncmp_P(path, PSTR("/fire?n="), 8) == 0) {
+              if (ir_state() == IR_IDLE && library_select(atoi(path + 8)))
+                pronto_replay(code_buf, CODE_BUFFER_SIZE);
+              route = ROUTE_REDIRECT;
+            } else if (path_is(path, PSTR("/carrier"))) {
+              if (strncmp_P(path, PSTR("/carrier?duty="), 14) == 0)
+                carrier_set_duty(atoi(path + 14));
+              route = ROUTE_CARRIER;
+            } else if (path_is(path, PSTR("/status"))) {
+              route = ROUTE_STATUS;
+            } else if (path_is(path, PSTR("/code"))) {
+              route = ROUTE_CODE;
+            } else if (find_asset(path, &asset)) {
+              strcpy_P(etag, asset.etag);
+              if (gzip)
+                strcat_P(etag, PSTR("-gz"));
+              not_modified = etag_match((char *)rx_buf, etag);
+              route = ROUTE_ASSET;
+            } else {
+              route = ROUTE_NOT_FOUND;
+            }
+            // The request is fully parsed, hand its blocks back
+            arena_free(rx_buf);
+            rx_buf=NULL;
+
+            tx_buf=arena_alloc(ARENA_TX,TX_BUF);
+            if (tx_buf == NULL) break;
+
+            switch (route) {
+              case ROUTE_ASSET:
+                send_asset(sockreg, tx_buf, &asset, gzip, not_modified);
+                break;
+              case ROUTE_REDIRECT:
+                // Back to the cached form page
+                http_header(tx_buf, PSTR("303 See Other"), NULL);
+                strcat_P((char *)tx_buf, PSTR("Location: /\r\n\r\n"));
+                w5100_send(sockreg, tx_buf, strlen((char *)tx_buf));
+                break;
+              case ROUTE_STATUS:
+                http_header(tx_buf, PSTR("200 OK"), PSTR("text/plain"));
+                strcat_P((char *)tx_buf, PSTR("Cache-Control: no-store\r\n\r\n"));
+                sprintf_P((char *)tx_buf+strlen((char *)tx_buf), PSTR("%u"), CODE_BUFFER_SIZE);
+                sprintf_P((char *)tx_buf+strlen((char *)tx_buf), PSTR(" (arena peak %u/%u, first edge %lu us, stack free %u)"), arena_high_water(), ARENA_SIZE, edge_latency, arena_stack_free());
+                w5100_send(sockreg, tx_buf, strlen((char *)tx_buf));
+                break;
+              case ROUTE_CODE:
+                http_header(tx_buf, PSTR("200 OK"), PSTR("text/plain"));
+                strcat_P((char *)tx_buf, PSTR("Cache-Control: no-store\r\n\r\n"));
+                if (w5100_send(sockreg, tx_buf, strlen((char *)tx_buf)) > 0 && code_buf != NULL)
+                  send_code_hex(sockreg, tx_buf);
+                break;
+              case ROUTE_LIBRARY:
+                http_header(tx_buf, PSTR("200 OK"), PSTR("text/plain"));
+                strcat_P((char *)tx_buf, PSTR("Cache-Control: no-store\r\n\r\n"));
+                sprintf_P((char *)tx_buf+strlen((char *)tx_buf), PSTR("%u codes, %u/%u bytes"), library_count(), library_used(), library_size());
+                sprintf_P((char *)tx_buf+strlen((char *)tx_buf), PSTR(" (last upload %u programmed, %u unchanged)"), library_programmed(), library_unchanged());
+                w5100_send(sockreg, tx_buf, strlen((char *)tx_buf));
+                break;
+              case ROUTE_CARRIER:
+                http_header(tx_buf, PSTR("200 OK"), PSTR("text/plain"));
+                strcat_P((char *)tx_buf, PSTR("Cache-Control: no-store\r\n\r\n"));
+                sprintf_P((char *)tx_buf+strlen((char *)tx_buf), PSTR("%lu Hz, Clk/%u TOP %u + %u/256"), carrier_hz(carrier_current()),
+                        1 << carrier_current()->shift, carrier_current()->top, carrier_current()->frac);
+                sprintf_P((char *)tx_buf+strlen((char *)tx_buf), PSTR(", duty %u%%"), carrier_duty());
+                w5100_send(sockreg, tx_buf, strlen((char *)tx_buf));
+                break;
+              case ROUTE_BAD:
+                http_header(tx_buf, PSTR("400 Bad Request"), PSTR("text/plain"));
+                strcat_P((char *)tx_buf, PSTR("\r\nBad Request\r\n"));
+                w5100_send(sockreg, tx_buf, strlen((char *)tx_buf));
+                break;
+              case ROUTE_FAILED:
+                http_header(tx_buf, PSTR("503 Service Unavailable"), PSTR("text/plain"));
+                strcat_P((char *)tx_buf, PSTR("\r\nNothing learned\r\n"));
+                w5100_send(sockreg, tx_buf, strlen((char *)tx_buf));
+                break;
+              case ROUTE_BUSY:
+                http_header(tx_buf, PSTR("503 Service Unavailable"), PSTR("text/plain"));
+                strcat_P((char *)tx_buf, PSTR("Retry-After: 1\r\n\r\nEmitter busy\r\n"));
+                w5100_send(sockreg, tx_buf, strlen((char *)tx_buf));
+                break;
+              default:
+                http_header(tx_buf, PSTR("404 Not Found"), PSTR("text/plain"));
+                strcat_P((char *)tx_buf, PSTR("\r\nNot Found\r\n"));
+                w5100_send(sockreg, tx_buf, strlen((char *)tx_buf));
+                break;
+            }
+            arena_free(tx_buf);
           }
+          if (rx_buf != NULL)
+            arena_free(rx_buf);
           // Disconnect the socket
-          disconnect(sockreg);
+          w5100_disconnect(sockreg);
         } else {
           _delay_us(1000);    // Wait for request
         }
@@ -498,7 +984,7 @@ int main(void){
       case SOCK_CLOSE_WAIT:
       case SOCK_LAST_ACK:
         // Force to close the socket
-        close(sockreg);
+        w5100_close(sockreg);
         break;
     }
   }